@@ -0,0 +1,518 @@
+/**
+    fbuff benchmarks
+
+    bench [-s <file size MB>] [-n <random reads>] [-d <dir>] [-j]
+
+    Writes a file of pseudo random bytes into dir, the current directory by
+    default, and reads it through every fbuff_init_ function, fbuff_init() with
+    fbuff_set_auto() between AUTO_MIN and AUTO_MAX, and through plain
+    fread(), read() and mmap() for comparison. Sequential runs read the whole
+    file with FBUFF_FILL for a range of buffer sizes; random runs do
+    fbuff_set_offset() and a read of RAND_READ bytes at random offsets. Every
+    run is done once with the file dropped from the page cache with
+    posix_fadvise(), which is best effort, and once with it cached.
+
+    Each run prints one CSV line, or one object of a JSON array with -j, with
+    the bytes read, MB/s, and the mean, median, 99th percentile and maximum
+    time of a single read call in nanoseconds. The file is removed at the end.
+*/
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "fbuff.h"
+
+#define MB (1024 * 1024)
+#define RAND_READ 4096
+#define URING_DEPTH 4
+#define AUTO_MIN (4 * 1024)
+#define AUTO_MAX (4 * 1024 * 1024)
+
+static const char prog[] = "bench";
+
+static const fbuff_off buff_sizes[] = {
+    4 * 1024,
+    16 * 1024,
+    64 * 1024,
+    256 * 1024,
+    1024 * 1024,
+    4 * 1024 * 1024
+};
+#define NSIZES (sizeof(buff_sizes) / sizeof(*buff_sizes))
+
+static char path[4096];
+static fbuff_off file_size;
+static uint64_t file_sum;
+static int json;
+static int nruns;
+//------------------------------------------------------------------------------
+
+typedef struct lat {
+    fbuff_off * ns;
+    fbuff_off n;
+    fbuff_off cap;
+    fbuff_off start;
+} lat;
+/** Time of each call in ns, and the start of the whole run. */
+
+static fbuff_off now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (fbuff_off)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+
+static void lat_add(lat * lt, fbuff_off ns)
+{
+    if (lt->n == lt->cap)
+    {
+        lt->cap = lt->cap ? lt->cap * 2 : 1024;
+        if (NULL == (lt->ns = realloc(lt->ns, lt->cap * sizeof(*lt->ns))))
+        {
+            fprintf(stderr, "%s: error: out of memory\n", prog);
+            exit(EXIT_FAILURE);
+        }
+    }
+    lt->ns[lt->n++] = ns;
+}
+//------------------------------------------------------------------------------
+
+static int cmp_off(const void * a, const void * b)
+{
+    fbuff_off x = *(const fbuff_off *)a;
+    fbuff_off y = *(const fbuff_off *)b;
+    return (x > y) - (x < y);
+}
+//------------------------------------------------------------------------------
+
+static uint64_t consume(const byte * data, fbuff_off len)
+{
+    uint64_t sum = 0;
+    fbuff_off i;
+
+    for (i = 0; i < len; i += 64)
+        sum += data[i];
+    return sum;
+}
+/** Touches every cache line, so mapped data is really read. */
+//------------------------------------------------------------------------------
+
+static uint64_t next_rand(uint64_t * state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return (*state = x);
+}
+//------------------------------------------------------------------------------
+
+static void drop_cache(int fd, int cold)
+{
+    if (cold)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+//------------------------------------------------------------------------------
+
+static void report(const char * bench, const char * mode, int cold,
+    fbuff_off buff_size, fbuff_off bytes, lat * lt, uint64_t sum)
+{
+    double secs = (now_ns() - lt->start) / 1e9;
+    fbuff_off total = 0, p50 = 0, p99 = 0, max = 0, i;
+
+    for (i = 0; i < lt->n; ++i)
+        total += lt->ns[i];
+    if (lt->n > 0)
+    {
+        qsort(lt->ns, lt->n, sizeof(*lt->ns), cmp_off);
+        p50 = lt->ns[lt->n / 2];
+        p99 = lt->ns[lt->n * 99 / 100];
+        max = lt->ns[lt->n - 1];
+    }
+
+    double mbs = (secs > 0) ? bytes / (double)MB / secs : 0;
+    double mean = (lt->n > 0) ? (double)total / lt->n : 0;
+    const char * cache = cold ? "cold" : "warm";
+
+    if (0 == strcmp(bench, "seq") && sum != file_sum)
+        fprintf(stderr, "%s: warning: %s %s %lld read wrong data\n", prog,
+            bench, mode, buff_size);
+
+    if (json)
+    {
+        printf("%s\n  {\"bench\": \"%s\", \"mode\": \"%s\", \"cache\": \"%s\", "
+            "\"buff_size\": %lld, \"bytes\": %lld, \"calls\": %lld, "
+            "\"seconds\": %.6f, \"mb_per_s\": %.2f, \"ns_mean\": %.0f, "
+            "\"ns_p50\": %lld, \"ns_p99\": %lld, \"ns_max\": %lld}",
+            nruns ? "," : "[", bench, mode, cache, buff_size, bytes, lt->n,
+            secs, mbs, mean, p50, p99, max);
+    }
+    else
+    {
+        if (0 == nruns)
+            printf("bench,mode,cache,buff_size,bytes,calls,seconds,mb_per_s,"
+                "ns_mean,ns_p50,ns_p99,ns_max\n");
+        printf("%s,%s,%s,%lld,%lld,%lld,%.6f,%.2f,%.0f,%lld,%lld,%lld\n",
+            bench, mode, cache, buff_size, bytes, lt->n, secs, mbs, mean, p50,
+            p99, max);
+    }
+    fflush(stdout);
+
+    ++nruns;
+    free(lt->ns);
+    memset(lt, 0, sizeof(*lt));
+}
+//------------------------------------------------------------------------------
+
+typedef int (*init_fn)(fbuff * fb, FILE * fp, fbuff_off buff_size);
+
+static int init_fd(fbuff * fb, FILE * fp, fbuff_off buff_size)
+{
+    return fbuff_init_fd(fb, fileno(fp), buff_size);
+}
+//------------------------------------------------------------------------------
+
+static int init_uring(fbuff * fb, FILE * fp, fbuff_off buff_size)
+{
+    return fbuff_init_uring(fb, fp, buff_size, URING_DEPTH);
+}
+//------------------------------------------------------------------------------
+
+static int init_auto(fbuff * fb, FILE * fp, fbuff_off buff_size)
+{
+    int err = fbuff_init(fb, fp, buff_size);
+    return (err != 0) ? err : fbuff_set_auto(fb, AUTO_MIN, AUTO_MAX);
+}
+//------------------------------------------------------------------------------
+
+static const struct {
+    const char * name;
+    init_fn init;
+} modes[] = {
+    {"fbuff_init", fbuff_init},
+    {"fbuff_init_fd", init_fd},
+    {"fbuff_init_mmap", fbuff_init_mmap},
+    {"fbuff_init_prefetch", fbuff_init_prefetch},
+    {"fbuff_init_uring", init_uring},
+    {"fbuff_init_direct", fbuff_init_direct},
+    {"fbuff_set_auto", init_auto}
+};
+#define NMODES (sizeof(modes) / sizeof(*modes))
+//------------------------------------------------------------------------------
+
+static void bench_fbuff(int m, fbuff_off buff_size, int random, fbuff_off nrand,
+    int cold)
+{
+    FILE * fp = fopen(path, "rb");
+    if (NULL == fp)
+        return;
+    drop_cache(fileno(fp), cold);
+
+    lat lt = {0};
+    fbuff fb;
+    byte * data = NULL;
+    uint64_t sum = 0, seed = 88172645463325252ULL;
+    fbuff_off bytes = 0, got, t0, i;
+
+    lt.start = now_ns();
+    if (modes[m].init(&fb, fp, buff_size) != 0)
+    {
+        fbuff_free(&fb);
+        fclose(fp);
+        return;
+    }
+
+    if (random)
+    {
+        for (i = 0; i < nrand; ++i)
+        {
+            fbuff_off offset = next_rand(&seed) % (file_size - RAND_READ + 1);
+
+            t0 = now_ns();
+            fbuff_set_offset(&fb, offset);
+            got = fbuff_read(&fb, RAND_READ);
+            lat_add(&lt, now_ns() - t0);
+
+            fbuff_data(&fb, &data);
+            sum += consume(data, got);
+            bytes += got;
+        }
+    }
+    else
+    {
+        while (1)
+        {
+            t0 = now_ns();
+            got = fbuff_read(&fb, FBUFF_FILL);
+            lat_add(&lt, now_ns() - t0);
+            if (got <= 0)
+                break;
+
+            fbuff_data(&fb, &data);
+            sum += consume(data, got);
+            bytes += got;
+        }
+    }
+
+    fbuff_free(&fb);
+    fclose(fp);
+    report(random ? "rand" : "seq", modes[m].name, cold, buff_size, bytes,
+        &lt, sum);
+}
+//------------------------------------------------------------------------------
+
+static void bench_fread(fbuff_off buff_size, int cold)
+{
+    FILE * fp = fopen(path, "rb");
+    byte * buff = malloc((size_t)buff_size);
+    if (NULL == fp || NULL == buff)
+        goto out;
+    drop_cache(fileno(fp), cold);
+
+    lat lt = {0};
+    uint64_t sum = 0;
+    fbuff_off bytes = 0, got, t0;
+
+    lt.start = now_ns();
+    while (1)
+    {
+        t0 = now_ns();
+        got = fread(buff, 1, (size_t)buff_size, fp);
+        lat_add(&lt, now_ns() - t0);
+        if (got <= 0)
+            break;
+
+        sum += consume(buff, got);
+        bytes += got;
+    }
+    report("seq", "fread", cold, buff_size, bytes, &lt, sum);
+
+out:
+    free(buff);
+    if (fp)
+        fclose(fp);
+}
+//------------------------------------------------------------------------------
+
+static void bench_read(fbuff_off buff_size, int random, fbuff_off nrand,
+    int cold)
+{
+    int fd = open(path, O_RDONLY);
+    byte * buff = malloc((size_t)buff_size);
+    if (fd < 0 || NULL == buff)
+        goto out;
+    drop_cache(fd, cold);
+
+    lat lt = {0};
+    uint64_t sum = 0, seed = 88172645463325252ULL;
+    fbuff_off bytes = 0, got, t0, i;
+
+    lt.start = now_ns();
+    if (random)
+    {
+        for (i = 0; i < nrand; ++i)
+        {
+            off_t offset = next_rand(&seed) % (file_size - RAND_READ + 1);
+
+            t0 = now_ns();
+            got = pread(fd, buff, RAND_READ, offset);
+            lat_add(&lt, now_ns() - t0);
+
+            if (got > 0)
+            {
+                sum += consume(buff, got);
+                bytes += got;
+            }
+        }
+    }
+    else
+    {
+        while (1)
+        {
+            t0 = now_ns();
+            got = read(fd, buff, (size_t)buff_size);
+            lat_add(&lt, now_ns() - t0);
+            if (got <= 0)
+                break;
+
+            sum += consume(buff, got);
+            bytes += got;
+        }
+    }
+    report(random ? "rand" : "seq", random ? "pread" : "read", cold,
+        buff_size, bytes, &lt, sum);
+
+out:
+    free(buff);
+    if (fd >= 0)
+        close(fd);
+}
+//------------------------------------------------------------------------------
+
+static void bench_mmap(fbuff_off buff_size, int random, fbuff_off nrand,
+    int cold)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    drop_cache(fd, cold);
+
+    lat lt = {0};
+    uint64_t sum = 0, seed = 88172645463325252ULL;
+    fbuff_off bytes = 0, len, t0, i;
+
+    lt.start = now_ns();
+    byte * map = mmap(NULL, (size_t)file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == map)
+    {
+        close(fd);
+        return;
+    }
+
+    if (random)
+    {
+        for (i = 0; i < nrand; ++i)
+        {
+            fbuff_off offset = next_rand(&seed) % (file_size - RAND_READ + 1);
+
+            t0 = now_ns();
+            sum += consume(map + offset, RAND_READ);
+            lat_add(&lt, now_ns() - t0);
+            bytes += RAND_READ;
+        }
+    }
+    else
+    {
+        for (i = 0; i < file_size; i += len)
+        {
+            len = (file_size - i < buff_size) ? file_size - i : buff_size;
+
+            t0 = now_ns();
+            sum += consume(map + i, len);
+            lat_add(&lt, now_ns() - t0);
+            bytes += len;
+        }
+    }
+
+    munmap(map, (size_t)file_size);
+    close(fd);
+    report(random ? "rand" : "seq", "mmap", cold, buff_size, bytes, &lt, sum);
+}
+/** Times touching the data, since that is when a mapping is read. */
+//------------------------------------------------------------------------------
+
+static int make_file(const char * dir)
+{
+    snprintf(path, sizeof(path), "%s/fbuff_bench_%ld.bin", dir,
+        (long)getpid());
+
+    FILE * fp = fopen(path, "wb");
+    byte * buff = malloc(MB);
+    uint64_t seed = 2463534242ULL;
+    fbuff_off done, i;
+
+    if (NULL == fp || NULL == buff)
+    {
+        free(buff);
+        if (fp)
+            fclose(fp);
+        return -1;
+    }
+
+    for (done = 0; done < file_size; done += MB)
+    {
+        for (i = 0; i < MB; i += 8)
+        {
+            uint64_t r = next_rand(&seed);
+            memcpy(buff + i, &r, 8);
+        }
+        file_sum += consume(buff, MB);
+        if (fwrite(buff, 1, MB, fp) != MB)
+            break;
+    }
+
+    free(buff);
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0 || fclose(fp) != 0 ||
+        done < file_size)
+    {
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+/** The file is written in whole MB, so every buffer size in buff_sizes reads
+the cache lines consume() sums at the same offsets. */
+//------------------------------------------------------------------------------
+
+int main(int argc, char * argv[])
+{
+    const char * dir = ".";
+    fbuff_off size_mb = 64;
+    fbuff_off nrand = 20000;
+    size_t s;
+    int i, m, cold;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-s") && i + 1 < argc)
+            size_mb = strtoll(argv[++i], NULL, 10);
+        else if (0 == strcmp(argv[i], "-n") && i + 1 < argc)
+            nrand = strtoll(argv[++i], NULL, 10);
+        else if (0 == strcmp(argv[i], "-d") && i + 1 < argc)
+            dir = argv[++i];
+        else if (0 == strcmp(argv[i], "-j"))
+            json = 1;
+        else
+        {
+            fprintf(stderr, "Use: %s [-s <file size MB>] [-n <random reads>] "
+                "[-d <dir>] [-j]\n", prog);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (size_mb < 1 || nrand < 0)
+    {
+        fprintf(stderr, "%s: error: bad size or number of reads\n", prog);
+        return EXIT_FAILURE;
+    }
+
+    file_size = size_mb * MB;
+    if (make_file(dir) != 0)
+    {
+        fprintf(stderr, "%s: error: couldn't write < %s >\n", prog, path);
+        return EXIT_FAILURE;
+    }
+
+    for (cold = 1; cold >= 0; --cold)
+    {
+        for (s = 0; s < NSIZES; ++s)
+        {
+            for (m = 0; m < (int)NMODES; ++m)
+                bench_fbuff(m, buff_sizes[s], 0, 0, cold);
+            bench_fread(buff_sizes[s], cold);
+            bench_read(buff_sizes[s], 0, 0, cold);
+            bench_mmap(buff_sizes[s], 0, 0, cold);
+        }
+
+        for (m = 0; m < (int)NMODES; ++m)
+            bench_fbuff(m, RAND_READ, 1, nrand, cold);
+        bench_read(RAND_READ, 1, nrand, cold);
+        bench_mmap(RAND_READ, 1, nrand, cold);
+    }
+
+    if (json)
+        printf("%s]\n", nruns ? "\n" : "[");
+
+    remove(path);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,294 @@
+#if !defined(FBFIND_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define FBFIND_X86
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "fbfind.h"
+
+#ifdef FBFIND_X86
+#include <immintrin.h>
+#endif
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+//------------------------------------------------------------------------------
+
+typedef struct fbfind_pat {
+    const byte * pattern;
+    fbuff_off len;
+    fbuff_off skip[256];
+} fbfind_pat;
+//------------------------------------------------------------------------------
+
+static const byte * fbfind_horspool(const byte * hay, fbuff_off n,
+    const fbfind_pat * fp)
+{
+    const byte * pat = fp->pattern;
+    fbuff_off m = fp->len;
+    fbuff_off i = 0;
+
+    while (i + m <= n)
+    {
+        byte last = hay[i + m - 1];
+        if (last == pat[m-1] && memcmp(hay + i, pat, (size_t)(m - 1)) == 0)
+            return hay + i;
+        i += fp->skip[last];
+    }
+    return NULL;
+}
+//------------------------------------------------------------------------------
+
+#ifdef FBFIND_X86
+static const byte * fbfind_naive(const byte * hay, fbuff_off n,
+    const byte * pat, fbuff_off m)
+{
+    fbuff_off i;
+
+    for (i = 0; i + m <= n; ++i)
+    {
+        if (hay[i] == pat[0] && memcmp(hay + i, pat, (size_t)m) == 0)
+            return hay + i;
+    }
+    return NULL;
+}
+/** Searches what is left after the last full vector of the SIMD searches. */
+//------------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+static const byte * fbfind_byte_sse2(const byte * hay, fbuff_off n, byte c)
+{
+    __m128i v = _mm_set1_epi8((char)c);
+    fbuff_off i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(b, v));
+        if (mask)
+            return hay + i + __builtin_ctz(mask);
+    }
+    return memchr(hay + i, c, (size_t)(n - i));
+}
+//------------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static const byte * fbfind_byte_avx2(const byte * hay, fbuff_off n, byte c)
+{
+    __m256i v = _mm256_set1_epi8((char)c);
+    fbuff_off i;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        __m256i b = _mm256_loadu_si256((const __m256i *)(hay + i));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, v));
+        if (mask)
+            return hay + i + __builtin_ctz(mask);
+    }
+    return memchr(hay + i, c, (size_t)(n - i));
+}
+//------------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+static const byte * fbfind_sub_sse2(const byte * hay, fbuff_off n,
+    const byte * pat, fbuff_off m)
+{
+    __m128i first = _mm_set1_epi8((char)pat[0]);
+    __m128i last = _mm_set1_epi8((char)pat[m-1]);
+    fbuff_off i;
+
+    for (i = 0; i + m - 1 + 16 <= n; i += 16)
+    {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(hay + i + m - 1));
+        unsigned mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(bf, first), _mm_cmpeq_epi8(bl, last)));
+
+        while (mask)
+        {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, pat + 1, (size_t)(m - 2)) == 0)
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return fbfind_naive(hay + i, n - i, pat, m);
+}
+//------------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static const byte * fbfind_sub_avx2(const byte * hay, fbuff_off n,
+    const byte * pat, fbuff_off m)
+{
+    __m256i first = _mm256_set1_epi8((char)pat[0]);
+    __m256i last = _mm256_set1_epi8((char)pat[m-1]);
+    fbuff_off i;
+
+    for (i = 0; i + m - 1 + 32 <= n; i += 32)
+    {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(hay + i + m - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(bf, first), _mm256_cmpeq_epi8(bl, last)));
+
+        while (mask)
+        {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, pat + 1, (size_t)(m - 2)) == 0)
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return fbfind_naive(hay + i, n - i, pat, m);
+}
+#endif
+//------------------------------------------------------------------------------
+
+static const byte * fbfind_byte(const byte * hay, fbuff_off n, byte c)
+{
+#ifdef FBFIND_X86
+    if (__builtin_cpu_supports("avx2"))
+        return fbfind_byte_avx2(hay, n, c);
+    if (__builtin_cpu_supports("sse2"))
+        return fbfind_byte_sse2(hay, n, c);
+#endif
+    return memchr(hay, c, (size_t)n);
+}
+//------------------------------------------------------------------------------
+
+static const byte * fbfind_sub(const byte * hay, fbuff_off n,
+    const fbfind_pat * fp)
+{
+    if (1 == fp->len)
+        return fbfind_byte(hay, n, fp->pattern[0]);
+
+#ifdef FBFIND_X86
+    if (fp->len <= FBFIND_SIMD_MAX)
+    {
+        if (__builtin_cpu_supports("avx2"))
+            return fbfind_sub_avx2(hay, n, fp->pattern, fp->len);
+        if (__builtin_cpu_supports("sse2"))
+            return fbfind_sub_sse2(hay, n, fp->pattern, fp->len);
+    }
+#endif
+    return fbfind_horspool(hay, n, fp);
+}
+//------------------------------------------------------------------------------
+
+static int fbfind_found(fbuff * fb, fbuff_off at, fbuff_off * offset)
+{
+    *offset = at;
+    return fbuff_set_offset(fb, at);
+}
+//------------------------------------------------------------------------------
+
+static int fbfind_end(fbuff * fb, fbuff_off read)
+{
+    if (read < 0)
+        return (int)read;
+    return (FBUFF_FERR == fbuff_state(fb)) ? FBUFF_FERR : FBUFF_EOF;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_find(fbuff * fb, const byte * pattern, fbuff_off len,
+    fbuff_off * offset)
+{
+    check(NULL == fb || NULL == pattern || NULL == offset || len < 1,
+        FBUFF_BAD_ARG);
+
+    fbfind_pat * fp = malloc(sizeof(*fp));
+    byte * joint = malloc((size_t)(2 * len));
+    fbuff_off i, tail_len = 0, tail_off = 0;
+    int result = FBUFF_EOF;
+
+    if (NULL == fp || NULL == joint)
+    {
+        free(fp);
+        free(joint);
+        return FBUFF_BAD_ALLOC;
+    }
+
+    fp->pattern = pattern;
+    fp->len = len;
+    for (i = 0; i < 256; ++i)
+        fp->skip[i] = len;
+    for (i = 0; i < len - 1; ++i)
+        fp->skip[pattern[i]] = len - 1 - i;
+
+    while (1)
+    {
+        fbuff_off base = fbuff_get_offset(fb);
+        fbuff_off read = fbuff_read(fb, FBUFF_FILL);
+        byte * data = NULL;
+        const byte * hit;
+
+        if (read <= 0)
+        {
+            result = fbfind_end(fb, read);
+            break;
+        }
+        fbuff_data(fb, &data);
+
+        fbuff_off head = (read < len - 1) ? read : len - 1;
+        memcpy(joint + tail_len, data, (size_t)head);
+        if (tail_len > 0)
+        {
+            if ((hit = fbfind_sub(joint, tail_len + head, fp)))
+            {
+                result = fbfind_found(fb, tail_off + (hit - joint), offset);
+                break;
+            }
+        }
+
+        if ((hit = fbfind_sub(data, read, fp)))
+        {
+            result = fbfind_found(fb, base + (hit - data), offset);
+            break;
+        }
+
+        if (read >= len - 1)
+        {
+            tail_len = len - 1;
+            memcpy(joint, data + read - tail_len, (size_t)tail_len);
+        }
+        else
+        {
+            fbuff_off keep = tail_len + read;
+            if (keep > len - 1)
+                keep = len - 1;
+            memmove(joint, joint + tail_len + read - keep, (size_t)keep);
+            tail_len = keep;
+        }
+        tail_off = base + read - tail_len;
+    }
+
+    free(fp);
+    free(joint);
+    return result;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_find_byte(fbuff * fb, int c, fbuff_off * offset)
+{
+    check(NULL == fb || NULL == offset || c < 0 || c > 0xFF, FBUFF_BAD_ARG);
+
+    while (1)
+    {
+        fbuff_off base = fbuff_get_offset(fb);
+        fbuff_off read = fbuff_read(fb, FBUFF_FILL);
+        byte * data = NULL;
+        const byte * hit;
+
+        if (read <= 0)
+            return fbfind_end(fb, read);
+
+        fbuff_data(fb, &data);
+        if ((hit = fbfind_byte(data, read, (byte)c)))
+            return fbfind_found(fb, base + (hit - data), offset);
+    }
+}
+//------------------------------------------------------------------------------
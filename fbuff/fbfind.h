@@ -0,0 +1,60 @@
+/**
+    Search within a buffered file
+
+    Scans a fbuff forward from its current position, that is from the first
+    byte the next fbuff_read() would return, through as many FBUFF_FILL reads
+    as needed. Matches which straddle two reads are found as well. On success
+    the fbuff is positioned at the start of the match, so the next
+    fbuff_read() returns the match and what follows it.
+
+    On x86 the buffers are scanned with AVX2 or SSE2 compares, picked at run
+    time. Patterns of up to FBFIND_SIMD_MAX bytes are found by comparing their
+    first and last bytes 16 or 32 positions at a time; longer ones use
+    Boyer-Moore-Horspool. Elsewhere, or if FBFIND_NO_SIMD is defined on
+    compilation, scalar code is used.
+
+    Both functions use the buffer of the fbuff and change its state and read
+    counters just like the reads they do.
+*/
+
+#ifndef FBFIND_H
+#define FBFIND_H
+
+#include "fbuff.h"
+
+#define FBFIND_SIMD_MAX 32
+
+int fbuff_find(fbuff * fb, const byte * pattern, fbuff_off len,
+    fbuff_off * offset);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb, pattern or offset is NULL, or len is < 1.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    FBUFF_FERR if reading fails.
+    FBUFF_EOF if the pattern was not found before eof.
+    FBUFF_BAD_OFFSET if fb reads a stream and the occurrence starts before the
+    data in the buffer.
+    0 on success.
+
+Description: Finds the next occurrence of the len bytes at pattern, sets
+offset to its position in the file and positions fb there. On a stream an
+occurrence which spans two reads can't be gone back to, so only offset is set
+for it.
+*/
+
+int fbuff_find_byte(fbuff * fb, int c, fbuff_off * offset);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb or offset is NULL, or c is not a byte value.
+
+Always
+    Same values as fbuff_find().
+
+Description: Finds the next occurrence of the byte c, sets offset to its
+position in the file and positions fb there.
+*/
+#endif
@@ -0,0 +1,499 @@
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define FBPOOL_THREADS
+#ifdef __linux__
+#define _GNU_SOURCE
+#define FBPOOL_HUGE_PAGES
+#endif
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include "fbpool.h"
+
+#ifdef FBPOOL_THREADS
+#include <pthread.h>
+#endif
+#ifdef FBPOOL_HUGE_PAGES
+#include <sys/mman.h>
+#endif
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+//------------------------------------------------------------------------------
+
+struct fbpool_cache {
+    fbuff_pool * pool;
+    byte * slots[FBPOOL_CLASSES][FBPOOL_CACHE_SLOTS];
+    int count[FBPOOL_CLASSES];
+    struct fbpool_cache * prev;
+    struct fbpool_cache * next;
+};
+/** The buffers a thread keeps for itself. Linked into the pool, so the pool
+can free them when the thread is still alive. */
+
+struct fbuff_pool {
+    fbuff_off limit;
+    int wait_ms;
+    int flags;
+    byte * free[FBPOOL_CLASSES];
+    fbuff_pool_usage usage;
+    int waiting;
+#ifdef FBPOOL_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_key_t key;
+    struct fbpool_cache * caches;
+#endif
+};
+/** The free lists are linked through the first bytes of the buffers. Only
+the caches are touched without the lock, each by its own thread. */
+//------------------------------------------------------------------------------
+
+static int fbpool_class_of(fbuff_off size)
+{
+    fbuff_off csize = FBPOOL_MIN_CLASS;
+    int cls = 0;
+
+    while (csize < size)
+    {
+        csize <<= 1;
+        ++cls;
+    }
+    return cls;
+}
+//------------------------------------------------------------------------------
+
+static byte * fbpool_next(byte * buff)
+{
+    byte * next;
+    memcpy(&next, buff, sizeof(next));
+    return next;
+}
+//------------------------------------------------------------------------------
+
+static void fbpool_push(fbuff_pool * pool, int cls, byte * buff)
+{
+    memcpy(buff, &pool->free[cls], sizeof(pool->free[cls]));
+    pool->free[cls] = buff;
+}
+//------------------------------------------------------------------------------
+
+static int fbpool_mapped(fbuff_pool * pool, fbuff_off size)
+{
+#ifdef FBPOOL_HUGE_PAGES
+    return (pool->flags & FBPOOL_HUGE) && size >= FBPOOL_HUGE_SIZE;
+#else
+    (void)pool;
+    (void)size;
+    return 0;
+#endif
+}
+//------------------------------------------------------------------------------
+
+static byte * fbpool_alloc(fbuff_pool * pool, fbuff_off size)
+{
+#ifdef FBPOOL_HUGE_PAGES
+    if (fbpool_mapped(pool, size))
+    {
+        void * map = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (MAP_FAILED == map)
+        {
+            map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (MAP_FAILED == map)
+                return NULL;
+#ifdef MADV_HUGEPAGE
+            madvise(map, (size_t)size, MADV_HUGEPAGE);
+#endif
+        }
+        return map;
+    }
+#endif
+
+    if ((uint64_t)size > SIZE_MAX)
+        return NULL;
+    return malloc((size_t)size);
+}
+/** Reserved huge pages are tried first, then transparent huge pages. */
+//------------------------------------------------------------------------------
+
+static void fbpool_release(fbuff_pool * pool, byte * buff, fbuff_off size)
+{
+#ifdef FBPOOL_HUGE_PAGES
+    if (fbpool_mapped(pool, size))
+    {
+        munmap(buff, (size_t)size);
+        return;
+    }
+#endif
+    (void)pool;
+    (void)size;
+    free(buff);
+}
+//------------------------------------------------------------------------------
+
+static void fbpool_lock(fbuff_pool * pool)
+{
+#ifdef FBPOOL_THREADS
+    pthread_mutex_lock(&pool->lock);
+#else
+    (void)pool;
+#endif
+}
+//------------------------------------------------------------------------------
+
+static void fbpool_unlock(fbuff_pool * pool)
+{
+#ifdef FBPOOL_THREADS
+    pthread_mutex_unlock(&pool->lock);
+#else
+    (void)pool;
+#endif
+}
+//------------------------------------------------------------------------------
+
+static void fbpool_wake(fbuff_pool * pool)
+{
+#ifdef FBPOOL_THREADS
+    if (pool->waiting > 0)
+        pthread_cond_broadcast(&pool->cond);
+#else
+    (void)pool;
+#endif
+}
+//------------------------------------------------------------------------------
+
+static int fbpool_wait(fbuff_pool * pool, const struct timespec * until)
+{
+#ifdef FBPOOL_THREADS
+    int err;
+
+    ++pool->waiting;
+    if (pool->wait_ms < 0)
+        err = pthread_cond_wait(&pool->cond, &pool->lock);
+    else
+        err = pthread_cond_timedwait(&pool->cond, &pool->lock, until);
+    --pool->waiting;
+    return err;
+#else
+    (void)pool;
+    (void)until;
+    return -1;
+#endif
+}
+/** Called with the lock held. Returns 0 when woken up, which doesn't mean
+there is room now. */
+//------------------------------------------------------------------------------
+
+static void fbpool_deadline(fbuff_pool * pool, struct timespec * until)
+{
+#ifdef FBPOOL_THREADS
+    clock_gettime(CLOCK_REALTIME, until);
+    until->tv_sec += pool->wait_ms / 1000;
+    until->tv_nsec += (long)(pool->wait_ms % 1000) * 1000000L;
+    if (until->tv_nsec >= 1000000000L)
+    {
+        ++until->tv_sec;
+        until->tv_nsec -= 1000000000L;
+    }
+#else
+    (void)pool;
+    (void)until;
+#endif
+}
+//------------------------------------------------------------------------------
+
+static int fbpool_room(fbuff_pool * pool, struct fbpool_cache * tc, int cls)
+{
+    fbuff_off csize = (fbuff_off)FBPOOL_MIN_CLASS << cls;
+    int i;
+
+    if (0 == pool->limit)
+        return 1;
+
+    for (i = FBPOOL_CLASSES - 1; i >= 0; --i)
+    {
+        fbuff_off isize = (fbuff_off)FBPOOL_MIN_CLASS << i;
+
+        while (pool->usage.held + csize > pool->limit &&
+            (pool->free[i] || (tc && tc->count[i] > 0)))
+        {
+            byte * buff = pool->free[i];
+            if (buff)
+                pool->free[i] = fbpool_next(buff);
+            else
+                buff = tc->slots[i][--tc->count[i]];
+
+            pool->usage.held -= isize;
+            fbpool_release(pool, buff, isize);
+        }
+    }
+    return pool->usage.held + csize <= pool->limit;
+}
+/** Called with the lock held when the free list of cls and the cache tc of
+the calling thread have no buffer of cls. Frees idle buffers of the other
+classes, the largest first, until a buffer of cls fits under the limit. */
+//------------------------------------------------------------------------------
+
+static int fbpool_take(fbuff_pool * pool, struct fbpool_cache * tc, int cls,
+    byte ** out)
+{
+    fbuff_off csize = (fbuff_off)FBPOOL_MIN_CLASS << cls;
+    struct timespec until;
+    int waited = 0, err = 0;
+
+    fbpool_lock(pool);
+    while (1)
+    {
+        if ((*out = pool->free[cls]))
+        {
+            pool->free[cls] = fbpool_next(*out);
+            break;
+        }
+
+        if (fbpool_room(pool, tc, cls))
+        {
+            pool->usage.held += csize;
+            ++pool->usage.allocs;
+            fbpool_unlock(pool);
+
+            if ((*out = fbpool_alloc(pool, csize)))
+                return 0;
+
+            fbpool_lock(pool);
+            pool->usage.held -= csize;
+            --pool->usage.allocs;
+            fbpool_wake(pool);
+            err = FBUFF_BAD_ALLOC;
+            break;
+        }
+
+        if (0 == pool->wait_ms)
+        {
+            err = FBUFF_BAD_ALLOC;
+            break;
+        }
+        if (!waited)
+        {
+            waited = 1;
+            ++pool->usage.waits;
+            fbpool_deadline(pool, &until);
+        }
+        if (fbpool_wait(pool, &until) != 0)
+        {
+            err = FBUFF_BAD_ALLOC;
+            break;
+        }
+    }
+    fbpool_unlock(pool);
+    return err;
+}
+/** The room for a new buffer is taken before allocating it without the
+lock, and given back if that fails. */
+//------------------------------------------------------------------------------
+
+#ifdef FBPOOL_THREADS
+static void fbpool_cache_exit(void * arg)
+{
+    struct fbpool_cache * tc = arg;
+    fbuff_pool * pool = tc->pool;
+    int cls;
+
+    pthread_mutex_lock(&pool->lock);
+    for (cls = 0; cls < FBPOOL_CLASSES; ++cls)
+    {
+        while (tc->count[cls] > 0)
+            fbpool_push(pool, cls, tc->slots[cls][--tc->count[cls]]);
+    }
+
+    if (tc->prev)
+        tc->prev->next = tc->next;
+    else
+        pool->caches = tc->next;
+    if (tc->next)
+        tc->next->prev = tc->prev;
+
+    fbpool_wake(pool);
+    pthread_mutex_unlock(&pool->lock);
+    free(tc);
+}
+/** Runs when a thread exits, and moves its buffers to the free lists. */
+//------------------------------------------------------------------------------
+
+static struct fbpool_cache * fbpool_cache(fbuff_pool * pool)
+{
+    struct fbpool_cache * tc = pthread_getspecific(pool->key);
+
+    if (tc || NULL == (tc = calloc(1, sizeof(*tc))))
+        return tc;
+
+    if (pthread_setspecific(pool->key, tc) != 0)
+    {
+        free(tc);
+        return NULL;
+    }
+
+    tc->pool = pool;
+    pthread_mutex_lock(&pool->lock);
+    tc->next = pool->caches;
+    if (pool->caches)
+        pool->caches->prev = tc;
+    pool->caches = tc;
+    pthread_mutex_unlock(&pool->lock);
+    return tc;
+}
+/** The cache of the calling thread, made on first use. */
+//------------------------------------------------------------------------------
+
+static int fbpool_waiting(fbuff_pool * pool)
+{
+    int waiting;
+
+    if (0 == pool->limit)
+        return 0;
+
+    pthread_mutex_lock(&pool->lock);
+    waiting = pool->waiting;
+    pthread_mutex_unlock(&pool->lock);
+    return waiting;
+}
+/** Without a limit nobody waits. */
+#endif
+//------------------------------------------------------------------------------
+
+int fbuff_pool_new(fbuff_pool ** out, fbuff_off limit, int wait_ms, int flags)
+{
+    check(NULL == out || limit < 0 || (flags & ~FBPOOL_HUGE), FBUFF_BAD_ARG);
+
+    fbuff_pool * pool = calloc(1, sizeof(*pool));
+    if (NULL == pool)
+        return FBUFF_BAD_ALLOC;
+
+#ifdef FBPOOL_THREADS
+    if (pthread_key_create(&pool->key, fbpool_cache_exit) != 0)
+    {
+        free(pool);
+        return FBUFF_BAD_ALLOC;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+#endif
+
+    pool->limit = limit;
+    pool->wait_ms = wait_ms;
+    pool->flags = flags;
+    *out = pool;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+fbuff_off fbuff_pool_class(fbuff_off size)
+{
+    check(size < 1 || size > FBPOOL_MAX_SIZE, FBUFF_BAD_ARG);
+    return (fbuff_off)FBPOOL_MIN_CLASS << fbpool_class_of(size);
+}
+//------------------------------------------------------------------------------
+
+int fbuff_pool_get(fbuff_pool * pool, fbuff_off size, byte ** out)
+{
+    check(NULL == pool || NULL == out || size < 1 || size > FBPOOL_MAX_SIZE,
+        FBUFF_BAD_ARG);
+
+    int cls = fbpool_class_of(size);
+    struct fbpool_cache * tc = NULL;
+
+#ifdef FBPOOL_THREADS
+    tc = pthread_getspecific(pool->key);
+    if (tc && tc->count[cls] > 0)
+    {
+        *out = tc->slots[cls][--tc->count[cls]];
+        return 0;
+    }
+#endif
+    return fbpool_take(pool, tc, cls, out);
+}
+//------------------------------------------------------------------------------
+
+int fbuff_pool_put(fbuff_pool * pool, byte * buff, fbuff_off size)
+{
+    check(NULL == pool || NULL == buff || size < 1 || size > FBPOOL_MAX_SIZE,
+        FBUFF_BAD_ARG);
+
+    int cls = fbpool_class_of(size);
+
+#ifdef FBPOOL_THREADS
+    struct fbpool_cache * tc = fbpool_cache(pool);
+    if (tc && tc->count[cls] < FBPOOL_CACHE_SLOTS && !fbpool_waiting(pool))
+    {
+        tc->slots[cls][tc->count[cls]++] = buff;
+        return 0;
+    }
+#endif
+
+    fbpool_lock(pool);
+    fbpool_push(pool, cls, buff);
+    fbpool_wake(pool);
+    fbpool_unlock(pool);
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_pool_stats(fbuff_pool * pool, fbuff_pool_usage * out)
+{
+    check(NULL == pool || NULL == out, FBUFF_BAD_ARG);
+
+    fbpool_lock(pool);
+    *out = pool->usage;
+    fbpool_unlock(pool);
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_pool_free(fbuff_pool * pool)
+{
+    check(NULL == pool, FBUFF_BAD_ARG);
+
+    int cls;
+
+#ifdef FBPOOL_THREADS
+    while (pool->caches)
+    {
+        struct fbpool_cache * tc = pool->caches;
+        pool->caches = tc->next;
+
+        for (cls = 0; cls < FBPOOL_CLASSES; ++cls)
+        {
+            while (tc->count[cls] > 0)
+                fbpool_push(pool, cls, tc->slots[cls][--tc->count[cls]]);
+        }
+        free(tc);
+    }
+    pthread_key_delete(pool->key);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+#endif
+
+    for (cls = 0; cls < FBPOOL_CLASSES; ++cls)
+    {
+        while (pool->free[cls])
+        {
+            byte * buff = pool->free[cls];
+            pool->free[cls] = fbpool_next(buff);
+            fbpool_release(pool, buff, (fbuff_off)FBPOOL_MIN_CLASS << cls);
+        }
+    }
+
+    free(pool);
+    return 0;
+}
+//------------------------------------------------------------------------------
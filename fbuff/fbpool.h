@@ -0,0 +1,139 @@
+/**
+    A shared buffer pool
+
+    Lends buffers to fbuff instances, and to anyone else, instead of having
+    each one malloc() and free() its own. A requested size is rounded up to
+    a power of two size class of at least FBPOOL_MIN_CLASS bytes, and buffers
+    given back are kept on a free list of their class for the next borrow, so
+    opening and closing many files reuses the same few buffers, whose pages
+    are already faulted in. Each thread keeps up to FBPOOL_CACHE_SLOTS buffers
+    of every class for itself, which it lends and takes back without locking.
+    With FBPOOL_HUGE, buffers of FBPOOL_HUGE_SIZE bytes and more are mapped
+    with huge pages on Linux. A pool can have a limit on the bytes it holds,
+    lent or not. A borrow which would go over it first frees idle buffers of
+    the other classes, and then waits for a buffer to come back.
+
+    On systems without pthreads there is no per thread cache, and a pool must
+    be used by a single thread.
+*/
+
+#ifndef FBPOOL_H
+#define FBPOOL_H
+
+#include "fbuff.h"
+
+#define FBPOOL_MIN_CLASS    (4 * 1024)
+#define FBPOOL_CLASSES      20
+#define FBPOOL_MAX_SIZE \
+    ((fbuff_off)FBPOOL_MIN_CLASS << (FBPOOL_CLASSES - 1))
+#define FBPOOL_CACHE_SLOTS  4
+#define FBPOOL_HUGE_SIZE    (2 * 1024 * 1024)
+
+enum {
+    FBPOOL_HUGE = 0x1
+};
+/** Pool flags. */
+
+typedef struct fbuff_pool fbuff_pool;
+
+typedef struct fbuff_pool_usage {
+    fbuff_off held;
+    fbuff_off allocs;
+    fbuff_off waits;
+} fbuff_pool_usage;
+/** held is the number of bytes in buffers the pool has allocated and not
+freed, lent or not. allocs counts the buffers it has allocated, and waits the
+borrows which had to wait for the limit. */
+
+int fbuff_pool_new(fbuff_pool ** out, fbuff_off limit, int wait_ms, int flags);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when out is NULL, limit is < 0, or flags has bits other than
+    the FBPOOL_ flags.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    0 on success.
+
+Description: Creates a pool and sets out pointing to it. The pool holds at
+most limit bytes, or any amount when limit is 0. A borrow which finds the
+pool at its limit waits up to wait_ms milliseconds for a buffer to come back,
+forever if wait_ms is < 0. The buffers in the caches of the threads count
+toward the limit too, but are not freed to make room.
+*/
+
+fbuff_off fbuff_pool_class(fbuff_off size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when size is < 1 or > FBPOOL_MAX_SIZE.
+
+Always
+    The size of the buffers lent for size bytes.
+
+Description: Rounds size up to its size class. All of the class size is
+usable.
+*/
+
+int fbuff_pool_get(fbuff_pool * pool, fbuff_off size, byte ** out);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pool or out is NULL, size is < 1, or size is >
+    FBPOOL_MAX_SIZE.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails, or the pool stayed at its
+    limit for longer than its wait.
+    0 on success.
+
+Description: Borrows a buffer of at least size bytes and sets out pointing to
+it. The buffer comes from the cache of the calling thread, or from the free
+list of its class, and is allocated only when both are empty. Its contents
+are undefined.
+*/
+
+int fbuff_pool_put(fbuff_pool * pool, byte * buff, fbuff_off size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pool or buff is NULL, size is < 1, or size is >
+    FBPOOL_MAX_SIZE.
+
+Always
+    0 on success.
+
+Description: Gives back buff, borrowed from pool with fbuff_pool_get() for
+size bytes, or any size of the same class. It goes to the cache of the calling
+thread when there is room and no borrow is waiting, else to the free list of
+its class. The thread giving a buffer back need not be the one which borrowed
+it.
+*/
+
+int fbuff_pool_stats(fbuff_pool * pool, fbuff_pool_usage * out);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pool or out is NULL.
+
+Always
+    0 on success.
+
+Description: Fills out with the memory use of the pool.
+*/
+
+int fbuff_pool_free(fbuff_pool * pool);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pool is NULL.
+
+Always
+    0 on success.
+
+Description: Frees the pool, and all the buffers in it and in the caches of
+the threads. All lent buffers must have been given back, and no other thread
+may be using the pool, or exiting after having used it.
+*/
+#endif
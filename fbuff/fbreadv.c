@@ -0,0 +1,306 @@
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define FBREADV_THREADS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "fbreadv.h"
+
+#ifdef FBREADV_THREADS
+#include <pthread.h>
+#endif
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+//------------------------------------------------------------------------------
+
+typedef struct fbreadv_item {
+    fbuff_off offset;
+    fbuff_off len;
+    fbuff_off index;
+} fbreadv_item;
+/** A range with a non negative offset and its place in the ranges array. */
+
+typedef struct fbreadv_group {
+    fbuff_off begin;
+    fbuff_off end;
+    fbuff_off first;
+    fbuff_off count;
+} fbreadv_group;
+/** A merged read from begin to end, holding count items from first. */
+
+typedef struct fbreadv_job {
+    fbuff * fb;
+    fbreadv_item * items;
+    fbreadv_group * groups;
+    fbuff_off ngroups;
+    fbuff_off next;
+    fbuff_off buff_size;
+    fbreadv_range fn;
+    void * arg;
+    int stop;
+#ifdef FBREADV_THREADS
+    pthread_mutex_t lock;
+#endif
+} fbreadv_job;
+/** Shared by the workers, which take the groups in order from next. */
+
+typedef struct fbreadv_worker {
+    fbreadv_job * job;
+    int result;
+#ifdef FBREADV_THREADS
+    pthread_t thread;
+    int started;
+#endif
+} fbreadv_worker;
+//------------------------------------------------------------------------------
+
+static int fbreadv_cmp(const void * a, const void * b)
+{
+    const fbreadv_item * x = a;
+    const fbreadv_item * y = b;
+
+    if (x->offset != y->offset)
+        return (x->offset < y->offset) ? -1 : 1;
+    return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off fbreadv_merge(fbreadv_item * items, fbuff_off n,
+    fbuff_off fsize, fbreadv_group * groups, fbuff_off * buff_size)
+{
+    fbuff_off ngroups = 0, i;
+    fbreadv_group * grp = NULL;
+
+    *buff_size = 1;
+    for (i = 0; i < n; ++i)
+    {
+        fbuff_off end = items[i].offset + items[i].len;
+        if (end > fsize)
+            end = fsize;
+
+        fbuff_off hi = (grp && grp->end > end) ? grp->end : end;
+        if (grp && items[i].offset <= grp->end + FBREADV_GAP &&
+            hi - grp->begin <= FBREADV_MAX_READ)
+        {
+            grp->end = hi;
+            ++grp->count;
+        }
+        else
+        {
+            grp = &groups[ngroups++];
+            grp->begin = items[i].offset;
+            grp->end = end;
+            grp->first = i;
+            grp->count = 1;
+        }
+
+        if (grp->end - grp->begin > *buff_size)
+            *buff_size = grp->end - grp->begin;
+    }
+    return ngroups;
+}
+/** Cuts the sorted items into groups read at once, and gives the size of the
+largest one. A range longer than FBREADV_MAX_READ gets a group of its own. */
+//------------------------------------------------------------------------------
+
+static fbuff_off fbreadv_next(fbreadv_job * job)
+{
+    fbuff_off g = -1;
+
+#ifdef FBREADV_THREADS
+    pthread_mutex_lock(&job->lock);
+#endif
+    if (!job->stop && job->next < job->ngroups)
+        g = job->next++;
+#ifdef FBREADV_THREADS
+    pthread_mutex_unlock(&job->lock);
+#endif
+    return g;
+}
+//------------------------------------------------------------------------------
+
+static void fbreadv_stop(fbreadv_job * job)
+{
+#ifdef FBREADV_THREADS
+    pthread_mutex_lock(&job->lock);
+#endif
+    job->stop = 1;
+#ifdef FBREADV_THREADS
+    pthread_mutex_unlock(&job->lock);
+#endif
+}
+//------------------------------------------------------------------------------
+
+static void * fbreadv_run(void * arg)
+{
+    fbreadv_worker * w = arg;
+    fbreadv_job * job = w->job;
+    byte * buff = malloc((size_t)job->buff_size);
+    fbuff_off g, i;
+
+    if (NULL == buff)
+    {
+        w->result = FBUFF_BAD_ALLOC;
+        fbreadv_stop(job);
+        return NULL;
+    }
+
+    while (0 == w->result && (g = fbreadv_next(job)) >= 0)
+    {
+        fbreadv_group * grp = &job->groups[g];
+        fbuff_off got = fbuff_read_at(job->fb, grp->begin,
+            grp->end - grp->begin, buff);
+
+        if (got < 0)
+        {
+            w->result = (int)got;
+            break;
+        }
+
+        for (i = grp->first; i < grp->first + grp->count; ++i)
+        {
+            fbreadv_item * it = &job->items[i];
+            fbuff_off at = it->offset - grp->begin;
+            fbuff_off len = got - at;
+
+            if (len > it->len)
+                len = it->len;
+            if (len < 0)
+                len = 0;
+
+            if ((w->result = job->fn(it->index, buff + at, len, job->arg)) != 0)
+                break;
+        }
+    }
+
+    if (w->result != 0)
+        fbreadv_stop(job);
+    free(buff);
+    return NULL;
+}
+//------------------------------------------------------------------------------
+
+static int fbreadv_start(fbreadv_worker * workers, int nworkers)
+{
+    int i, started = 0;
+
+#ifdef FBREADV_THREADS
+    for (i = 0; i < nworkers && nworkers > 1; ++i)
+    {
+        if (pthread_create(&workers[i].thread, NULL, fbreadv_run,
+            &workers[i]) == 0)
+        {
+            workers[i].started = 1;
+            ++started;
+        }
+    }
+
+    for (i = 0; i < nworkers; ++i)
+    {
+        if (workers[i].started)
+            pthread_join(workers[i].thread, NULL);
+    }
+#endif
+
+    if (0 == started)
+        fbreadv_run(&workers[0]);
+
+    for (i = 0; i < nworkers; ++i)
+    {
+        if (workers[i].result != 0)
+            return workers[i].result;
+    }
+    return 0;
+}
+/** A single worker runs on the calling thread. The groups left by workers
+which couldn't be started are read by the others, and by the calling thread
+when none could. */
+//------------------------------------------------------------------------------
+
+int fbuff_readv(fbuff * fb, const fbuff_range * ranges, fbuff_off n,
+    int nworkers, fbreadv_range fn, void * arg)
+{
+    check(NULL == fb || NULL == fn || (NULL == ranges && n > 0) || n < 0 ||
+        nworkers < 1, FBUFF_BAD_ARG);
+
+    fbuff_off fsize = fbuff_file_size(fb);
+    fbuff_off i;
+
+    if (fsize < 0)
+        return (int)fsize;
+    if (0 == n)
+        return 0;
+
+    fbreadv_item * items = malloc((size_t)n * sizeof(*items));
+    fbreadv_group * groups = malloc((size_t)n * sizeof(*groups));
+    fbreadv_worker * workers = NULL;
+    fbreadv_job job;
+    int result = 0;
+
+    if (NULL == items || NULL == groups)
+    {
+        result = FBUFF_BAD_ALLOC;
+        goto done;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        fbuff_off offset = ranges[i].offset;
+        if (offset < 0)
+            offset += fsize;
+
+        if (ranges[i].len < 0)
+        {
+            result = FBUFF_BAD_ARG;
+            goto done;
+        }
+        if (offset < 0 || offset > fsize)
+        {
+            result = FBUFF_BAD_OFFSET;
+            goto done;
+        }
+
+        items[i].offset = offset;
+        items[i].len = ranges[i].len;
+        items[i].index = i;
+    }
+    qsort(items, (size_t)n, sizeof(*items), fbreadv_cmp);
+
+    memset(&job, 0, sizeof(job));
+    job.fb = fb;
+    job.items = items;
+    job.groups = groups;
+    job.ngroups = fbreadv_merge(items, n, fsize, groups, &job.buff_size);
+    job.fn = fn;
+    job.arg = arg;
+
+    if (nworkers > job.ngroups)
+        nworkers = (int)job.ngroups;
+
+    if (NULL == (workers = calloc(nworkers, sizeof(*workers))))
+    {
+        result = FBUFF_BAD_ALLOC;
+        goto done;
+    }
+    for (i = 0; i < nworkers; ++i)
+        workers[i].job = &job;
+
+#ifdef FBREADV_THREADS
+    pthread_mutex_init(&job.lock, NULL);
+    result = fbreadv_start(workers, nworkers);
+    pthread_mutex_destroy(&job.lock);
+#else
+    result = fbreadv_start(workers, nworkers);
+#endif
+
+done:
+    free(workers);
+    free(groups);
+    free(items);
+    return result;
+}
+//------------------------------------------------------------------------------
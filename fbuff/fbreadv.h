@@ -0,0 +1,60 @@
+/**
+    Batched scatter reads
+
+    Reads a batch of (offset, length) ranges of the file of an initialized
+    fbuff with as few reads as it can. The ranges are sorted by offset, and
+    ranges which overlap, touch, or are at most FBREADV_GAP bytes apart are
+    merged into a single read of up to FBREADV_MAX_READ bytes, so hundreds of
+    lookups close to each other cost a handful of reads. The merged reads are
+    done with fbuff_read_at() by a pool of worker threads, each with its own
+    buffer, and every original range is handed to a user callback straight
+    from the buffer it was read into. The fbuff itself is left untouched. On
+    systems without pthreads the reads are done one after the other on the
+    calling thread.
+*/
+
+#ifndef FBREADV_H
+#define FBREADV_H
+
+#include "fbuff.h"
+
+#define FBREADV_GAP         (32 * 1024)
+#define FBREADV_MAX_READ    (1024 * 1024)
+
+typedef struct fbuff_range {
+    fbuff_off offset;
+    fbuff_off len;
+} fbuff_range;
+/** offset can be negative like in fbuff_set_offset(). */
+
+typedef int (*fbreadv_range)(fbuff_off index, const byte * data,
+    fbuff_off len, void * arg);
+/** Called once for every range with its index in the ranges array. len is
+less than asked only at eof. data is valid until the callback returns. A non
+zero return stops the reading and is returned by fbuff_readv(). */
+
+int fbuff_readv(fbuff * fb, const fbuff_range * ranges, fbuff_off n,
+    int nworkers, fbreadv_range fn, void * arg);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb or fn is NULL, ranges is NULL and n is > 0, n is < 0,
+    or nworkers is < 1.
+
+Always
+    FBUFF_BAD_ARG when the len of a range is < 0, or fb decompresses its file.
+    FBUFF_BAD_OFFSET when the offset of a range is outside the bounds of the
+    file.
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    FBUFF_FERR if reading fails.
+    FBUFF_NO_SIZE when the size of the file is not known.
+    The first non zero value returned by fn.
+    0 on success.
+
+Description: Reads all n ranges and calls fn for each one. The merged reads
+are shared between up to nworkers threads, which call fn themselves, so fn
+must be thread safe when nworkers is > 1, and the ranges come in no particular
+order. With a single worker fn is called on the calling thread in the order of
+the offsets. No range is read when a range is out of bounds.
+*/
+#endif
@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fbrec.h"
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+//------------------------------------------------------------------------------
+
+static fbuff_off fbrec_header(fbuff_rec * rec)
+{
+    return (FBREC_PREFIX == rec->framing) ? rec->param : 0;
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off fbrec_need(fbuff_rec * rec, const byte * start, fbuff_off have)
+{
+    fbuff_off i;
+    uint64_t len = 0;
+
+    if (FBREC_FIXED == rec->framing)
+        return rec->param;
+
+    if (have < rec->param)
+        return rec->param;
+
+    for (i = rec->param; i > 0; --i)
+        len = (len << 8) | start[i-1];
+
+    if (len > (uint64_t)(INT64_MAX - rec->param))
+        return FBUFF_FERR;
+    return rec->param + (fbuff_off)len;
+}
+/** Returns the full size of the record starting at start, of which have bytes
+are known, or the size of the length prefix while it is incomplete. A length
+too big for fbuff_off gives FBUFF_FERR. */
+//------------------------------------------------------------------------------
+
+static int fbrec_append(fbuff_rec * rec, const byte * src, fbuff_off n)
+{
+    if (rec->carry_len + n > rec->carry_cap)
+    {
+        fbuff_off cap = rec->carry_cap ? rec->carry_cap : 64;
+        while (cap < rec->carry_len + n)
+            cap *= 2;
+
+        byte * carry = realloc(rec->carry, (size_t)cap);
+        if (NULL == carry)
+            return FBUFF_BAD_ALLOC;
+
+        rec->carry = carry;
+        rec->carry_cap = cap;
+    }
+
+    if (n > 0)
+        memcpy(rec->carry + rec->carry_len, src, (size_t)n);
+    rec->carry_len += n;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+static int fbrec_from_carry(fbuff_rec * rec, byte ** ptr, fbuff_off * len)
+{
+    fbuff_off header = fbrec_header(rec);
+
+    rec->carried = 1;
+    *ptr = rec->carry + header;
+    *len = rec->carry_len - header;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_rec_init(fbuff_rec * rec, fbuff * fb, int framing, fbuff_off param)
+{
+    check(NULL == rec || NULL == fb, FBUFF_BAD_ARG);
+    check(framing != FBREC_NEWLINE && framing != FBREC_FIXED &&
+        framing != FBREC_PREFIX, FBUFF_BAD_ARG);
+    check(FBREC_FIXED == framing && param < 1, FBUFF_BAD_ARG);
+    check(FBREC_PREFIX == framing &&
+        param != 1 && param != 2 && param != 4 && param != 8, FBUFF_BAD_ARG);
+
+    memset(rec, 0, sizeof(*rec));
+    rec->fb = fb;
+    rec->framing = framing;
+    rec->param = (FBREC_NEWLINE == framing) ? 0 : param;
+    rec->cur = fbuff_last_read(fb);
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_next_record(fbuff_rec * rec, byte ** ptr, fbuff_off * len)
+{
+    check(NULL == rec || NULL == ptr || NULL == len, FBUFF_BAD_ARG);
+
+    int err;
+    if (rec->carried)
+    {
+        rec->carry_len = 0;
+        rec->carried = 0;
+    }
+
+    while (1)
+    {
+        byte * data = NULL;
+        fbuff_data(rec->fb, &data);
+        fbuff_off end = fbuff_last_read(rec->fb);
+        fbuff_off avail = end - rec->cur;
+        byte * start = data + rec->cur;
+
+        if (FBREC_NEWLINE == rec->framing && avail > 0)
+        {
+            byte * nl = memchr(start, '\n', (size_t)avail);
+            if (nl && 0 == rec->carry_len)
+            {
+                *ptr = start;
+                *len = nl - start;
+                rec->cur += *len + 1;
+                return 0;
+            }
+
+            fbuff_off take = nl ? nl - start : avail;
+            if ((err = fbrec_append(rec, start, take)) != 0)
+                return err;
+
+            rec->cur += take;
+            if (nl)
+            {
+                ++rec->cur;
+                return fbrec_from_carry(rec, ptr, len);
+            }
+        }
+        else if (avail > 0)
+        {
+            fbuff_off need;
+            if (0 == rec->carry_len &&
+                (need = fbrec_need(rec, start, avail)) <= avail && need >= 0)
+            {
+                fbuff_off header = fbrec_header(rec);
+                *ptr = start + header;
+                *len = need - header;
+                rec->cur += need;
+                return 0;
+            }
+
+            while (rec->cur < end &&
+                (need = fbrec_need(rec, rec->carry, rec->carry_len)) >
+                rec->carry_len)
+            {
+                fbuff_off take = need - rec->carry_len;
+                if (take > end - rec->cur)
+                    take = end - rec->cur;
+
+                if ((err = fbrec_append(rec, data + rec->cur, take)) != 0)
+                    return err;
+                rec->cur += take;
+            }
+
+            if (rec->carry_len > 0)
+            {
+                need = fbrec_need(rec, rec->carry, rec->carry_len);
+                if (need < 0)
+                {
+                    rec->carry_len = 0;
+                    return (int)need;
+                }
+                if (need == rec->carry_len)
+                    return fbrec_from_carry(rec, ptr, len);
+            }
+        }
+
+        fbuff_off read = fbuff_read(rec->fb, FBUFF_FILL);
+        if (read < 0)
+            return (int)read;
+
+        rec->cur = 0;
+        if (0 == read)
+        {
+            if (FBUFF_FERR == fbuff_state(rec->fb))
+                return FBUFF_FERR;
+            if (0 == rec->carry_len)
+                return FBUFF_EOF;
+            if (FBREC_NEWLINE == rec->framing)
+                return fbrec_from_carry(rec, ptr, len);
+
+            rec->carry_len = 0;
+            return FBUFF_FERR;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+
+int fbuff_rec_free(fbuff_rec * rec)
+{
+    check(NULL == rec, FBUFF_BAD_ARG);
+    free(rec->carry);
+    memset(rec, 0, sizeof(*rec));
+    return 0;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+/**
+    A record iterator
+
+    Splits the contents of a fbuff into records framed by a newline, by a fixed
+    width, or by a little endian length prefix. Records are returned as
+    pointers straight into the buffer of the fbuff. Only a record which
+    straddles two reads is copied, into a carry buffer owned by the iterator,
+    which grows as needed. Records start at the current position of the fbuff,
+    which is read with FBUFF_FILL as the iteration goes on. The fbuff must not
+    be read from or repositioned by anything else while an iterator uses it.
+
+    Pointers returned by fbuff_next_record() are valid until the next call.
+*/
+
+#ifndef FBREC_H
+#define FBREC_H
+
+#include "fbuff.h"
+
+enum {
+    FBREC_NEWLINE,
+    FBREC_FIXED,
+    FBREC_PREFIX
+};
+/** Framings. */
+
+typedef struct fbuff_rec {
+    fbuff * fb;
+    int framing;
+    fbuff_off param;
+    fbuff_off cur;
+    byte * carry;
+    fbuff_off carry_len;
+    fbuff_off carry_cap;
+    int carried;
+} fbuff_rec;
+/** Don't use members directly. */
+
+int fbuff_rec_init(fbuff_rec * rec, fbuff * fb, int framing, fbuff_off param);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when rec or fb is NULL, framing is unknown, param is < 1 for
+    FBREC_FIXED, or param is not 1, 2, 4 or 8 for FBREC_PREFIX.
+
+Always
+    0 on success.
+
+Description: Initializes an iterator over the records of fb. param is the
+record length for FBREC_FIXED and the size of the length prefix in bytes for
+FBREC_PREFIX. It is ignored for FBREC_NEWLINE.
+*/
+
+int fbuff_next_record(fbuff_rec * rec, byte ** ptr, fbuff_off * len);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when rec, ptr or len is NULL.
+
+Always
+    FBUFF_EOF when there are no more records.
+    FBUFF_FERR if reading fails, the file ends in the middle of a fixed width
+    or length prefixed record, or a length prefix is too big for fbuff_off.
+    FBUFF_BAD_ALLOC if the carry buffer can't grow.
+    0 on success.
+
+Description: Sets ptr and len to the next record. For FBREC_NEWLINE the '\n' is
+not part of the record, and a last line without one is still returned. For
+FBREC_PREFIX the prefix is not part of the record.
+*/
+
+int fbuff_rec_free(fbuff_rec * rec);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when rec is NULL.
+
+Always
+    0 on success.
+
+Description: Frees the carry buffer and zeroes out the iterator. The fbuff is
+not freed.
+*/
+#endif
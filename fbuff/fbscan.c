@@ -0,0 +1,194 @@
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define FBSCAN_THREADS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "fbscan.h"
+
+#ifdef FBSCAN_THREADS
+#include <pthread.h>
+#endif
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+
+#define PROBE_SIZE 4096
+//------------------------------------------------------------------------------
+
+typedef struct fbscan_worker {
+    fbuff * fb;
+    int index;
+    int align;
+    fbuff_off begin;
+    fbuff_off end;
+    fbuff_off buff_size;
+    fbscan_chunk chunk;
+    void * arg;
+    int result;
+#ifdef FBSCAN_THREADS
+    pthread_t thread;
+    int started;
+#endif
+} fbscan_worker;
+//------------------------------------------------------------------------------
+
+static fbuff_off fbscan_align(fbuff * fb, fbuff_off offset, int align)
+{
+    byte probe[PROBE_SIZE];
+    fbuff_off fsize = fbuff_file_size(fb);
+    fbuff_off read, i;
+
+    if (offset <= 0)
+        return 0;
+
+    for (--offset; offset < fsize; offset += read)
+    {
+        if ((read = fbuff_read_at(fb, offset, PROBE_SIZE, probe)) <= 0)
+            return (read < 0) ? read : fsize;
+
+        for (i = 0; i < read; ++i)
+        {
+            if (probe[i] == align)
+                return offset + i + 1;
+        }
+    }
+    return fsize;
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off fbscan_last(const byte * data, fbuff_off len, int align)
+{
+    fbuff_off i;
+
+    for (i = len; i > 0; --i)
+    {
+        if (data[i-1] == align)
+            return i;
+    }
+    return len;
+}
+//------------------------------------------------------------------------------
+
+static void * fbscan_run(void * arg)
+{
+    fbscan_worker * w = arg;
+    fbuff_off offset = w->begin;
+    byte * buff = malloc((size_t)w->buff_size);
+
+    if (NULL == buff)
+    {
+        w->result = FBUFF_BAD_ALLOC;
+        return NULL;
+    }
+
+    while (offset < w->end)
+    {
+        fbuff_off want = w->end - offset;
+        if (want > w->buff_size)
+            want = w->buff_size;
+
+        fbuff_off len = fbuff_read_at(w->fb, offset, want, buff);
+        if (len <= 0)
+        {
+            w->result = (len < 0) ? len : FBUFF_FERR;
+            break;
+        }
+
+        if (w->align != FBSCAN_NO_ALIGN && offset + len < w->end)
+            len = fbscan_last(buff, len, w->align);
+
+        if ((w->result = w->chunk(w->index, buff, offset, len, w->arg)) != 0)
+            break;
+
+        offset += len;
+    }
+
+    free(buff);
+    return NULL;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_scan(fbuff * fb, int nworkers, fbuff_off buff_size, int align,
+    fbscan_chunk chunk, fbscan_reduce reduce, void * arg)
+{
+    check(NULL == fb || NULL == chunk || nworkers < 1 || buff_size < 1,
+        FBUFF_BAD_ARG);
+    check((align < 0 || align > 0xFF) && align != FBSCAN_NO_ALIGN,
+        FBUFF_BAD_ARG);
+
+    fbscan_worker * workers = calloc(nworkers, sizeof(*workers));
+    if (NULL == workers)
+        return FBUFF_BAD_ALLOC;
+
+    fbuff_off fsize = fbuff_file_size(fb);
+    fbuff_off begin = 0;
+    int i, result = 0;
+
+    if (fsize < 0)
+    {
+        free(workers);
+        return (int)fsize;
+    }
+
+    for (i = 0; i < nworkers; ++i)
+    {
+        fbuff_off end = (i == nworkers - 1) ? fsize : fsize / nworkers * (i+1);
+
+        if (align != FBSCAN_NO_ALIGN && end < fsize)
+        {
+            if ((end = fbscan_align(fb, end, align)) < 0)
+            {
+                free(workers);
+                return (int)end;
+            }
+        }
+        if (end < begin)
+            end = begin;
+
+        workers[i].fb = fb;
+        workers[i].index = i;
+        workers[i].align = align;
+        workers[i].begin = begin;
+        workers[i].end = end;
+        workers[i].buff_size = buff_size;
+        workers[i].chunk = chunk;
+        workers[i].arg = arg;
+        begin = end;
+    }
+
+#ifdef FBSCAN_THREADS
+    for (i = 0; i < nworkers; ++i)
+    {
+        if (pthread_create(&workers[i].thread, NULL, fbscan_run,
+            &workers[i]) != 0)
+        {
+            workers[i].result = FBUFF_FERR;
+            continue;
+        }
+        workers[i].started = 1;
+    }
+
+    for (i = 0; i < nworkers; ++i)
+    {
+        if (workers[i].started)
+            pthread_join(workers[i].thread, NULL);
+    }
+#else
+    for (i = 0; i < nworkers; ++i)
+        fbscan_run(&workers[i]);
+#endif
+
+    for (i = 0; i < nworkers && 0 == result; ++i)
+        result = workers[i].result;
+
+    for (i = 0; i < nworkers && 0 == result && reduce; ++i)
+        result = reduce(i, arg);
+
+    free(workers);
+    return result;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,53 @@
+/**
+    A parallel file scanner
+
+    Splits the file of an initialized fbuff into byte ranges and scans them on
+    a pool of worker threads. Every worker has its own buffer and reads its
+    range with fbuff_read_at(), so the workers share the file but never its
+    position, and the fbuff itself is left untouched. Each filled buffer is
+    passed to a user callback, after which a reduce callback is called once
+    per worker, in worker order, on the calling thread.
+
+    Range and chunk boundaries can be aligned to records ending in a given
+    byte, e.g. '\n', so no record is ever split between two callback calls
+    unless it is longer than the buffer. On systems without pthreads the
+    workers run one after the other on the calling thread.
+*/
+
+#ifndef FBSCAN_H
+#define FBSCAN_H
+
+#include "fbuff.h"
+
+#define FBSCAN_NO_ALIGN -1
+
+typedef int (*fbscan_chunk)(int worker, const byte * data, fbuff_off offset,
+    fbuff_off len, void * arg);
+/** Called for every chunk read by worker. offset is the position of data in
+the file. A non zero return stops the worker and is returned by fbuff_scan(). */
+
+typedef int (*fbscan_reduce)(int worker, void * arg);
+/** Called once per worker after all workers are done. A non zero return is
+returned by fbuff_scan(). */
+
+int fbuff_scan(fbuff * fb, int nworkers, fbuff_off buff_size, int align,
+    fbscan_chunk chunk, fbscan_reduce reduce, void * arg);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb or chunk is NULL, nworkers is < 1, buff_size is < 1,
+    or align is not a byte value and different from FBSCAN_NO_ALIGN.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    FBUFF_FERR if reading fails or a worker can't be started.
+    FBUFF_NO_SIZE when the size of the file is not known.
+    The first non zero value returned by chunk or reduce.
+    0 on success.
+
+Description: Splits the file into nworkers ranges of about the same size and
+scans each one on its own thread with a buffer of buff_size bytes. If align is
+a byte value, every range starts right after an align byte, and every chunk
+except the last one of a range ends with one. reduce can be NULL.
+*/
+#endif
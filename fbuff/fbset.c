@@ -0,0 +1,365 @@
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define FBSET_POSIX
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "fbset.h"
+
+#ifdef FBSET_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+//------------------------------------------------------------------------------
+
+struct fbuff_fileset {
+    const char * const * paths;
+    fbuff_off n;
+    fbuff_off buff_size;
+    int depth;
+    byte * buffs;
+    fbuff_chunk * chunks;
+    int head;
+    int count;
+    int held;
+    int done;
+    int quit;
+    fbuff_off next;
+    int open;
+    fbuff_off offset;
+    fbuff_off size;
+#ifdef FBSET_POSIX
+    int fd;
+    int threaded;
+    int reader_waits;
+    int caller_waits;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t room;
+    pthread_cond_t ready;
+#else
+    FILE * pfile;
+#endif
+};
+/** The chunks from head on, count of them, are read and wait for the caller,
+who holds the one at head while held is set. The rest of the ring is free for
+the reader. next, open, offset, size and the file are the reader's own. Each
+side is only woken up when it waits, and the reader only once half of the
+ring is free, so a reader which keeps ahead costs few switches. */
+//------------------------------------------------------------------------------
+
+#ifdef FBSET_POSIX
+static fbuff_off fbset_read(fbuff_fileset * fs, byte * buff, fbuff_off nbytes,
+    int * err)
+{
+    fbuff_off all = 0;
+
+    while (all < nbytes)
+    {
+        ssize_t got = read(fs->fd, buff + all, (size_t)(nbytes - all));
+        if (got < 0 && EINTR == errno)
+            continue;
+        if (got < 0)
+        {
+            *err = FBUFF_FERR;
+            break;
+        }
+        if (0 == got)
+            break;
+        all += got;
+    }
+    return all;
+}
+//------------------------------------------------------------------------------
+
+static int fbset_open(fbuff_fileset * fs)
+{
+    struct stat st;
+
+    if ((fs->fd = open(fs->paths[fs->next], O_RDONLY)) < 0)
+        return FBUFF_FERR;
+
+    if (fstat(fs->fd, &st) != 0 || S_ISDIR(st.st_mode))
+    {
+        close(fs->fd);
+        return FBUFF_FERR;
+    }
+
+    fs->size = S_ISREG(st.st_mode) ? st.st_size : FBUFF_NO_SIZE;
+    return 0;
+}
+/** A size of 0 is not trusted to mean an empty file, since files like the
+ones in /proc have no size. */
+//------------------------------------------------------------------------------
+
+static void fbset_close(fbuff_fileset * fs)
+{
+    close(fs->fd);
+}
+#else
+static fbuff_off fbset_read(fbuff_fileset * fs, byte * buff, fbuff_off nbytes,
+    int * err)
+{
+    fbuff_off got = fread(buff, 1, (size_t)nbytes, fs->pfile);
+
+    if (ferror(fs->pfile))
+        *err = FBUFF_FERR;
+    return got;
+}
+//------------------------------------------------------------------------------
+
+static int fbset_open(fbuff_fileset * fs)
+{
+    if (NULL == (fs->pfile = fopen(fs->paths[fs->next], "rb")))
+        return FBUFF_FERR;
+
+    fs->size = FBUFF_NO_SIZE;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+static void fbset_close(fbuff_fileset * fs)
+{
+    fclose(fs->pfile);
+}
+#endif
+//------------------------------------------------------------------------------
+
+static int fbset_at_end(fbuff_fileset * fs)
+{
+    if (fs->size > 0)
+        return fs->offset >= fs->size;
+
+#ifndef FBSET_POSIX
+    int c = getc(fs->pfile);
+    if (c != EOF)
+    {
+        ungetc(c, fs->pfile);
+        return 0;
+    }
+    return 1;
+#else
+    return 0;
+#endif
+}
+/** Tells whether a full read ended the file. Without a size, stdio can look
+one byte ahead, while a descriptor needs one more read, which gives the file
+an empty last chunk. */
+//------------------------------------------------------------------------------
+
+static int fbset_fill(fbuff_fileset * fs, int slot)
+{
+    fbuff_chunk * ch = &fs->chunks[slot];
+    byte * buff = fs->buffs + slot * fs->buff_size;
+    int err = 0;
+
+    if (fs->next >= fs->n)
+        return 0;
+
+    ch->index = fs->next;
+    ch->offset = fs->offset;
+    ch->data = buff;
+    ch->len = 0;
+    ch->last = 1;
+    ch->err = 0;
+
+    if (!fs->open)
+    {
+        if (fbset_open(fs) != 0)
+        {
+            ch->err = FBUFF_FERR;
+            ++fs->next;
+            return 1;
+        }
+        fs->open = 1;
+    }
+
+    fbuff_off want = fs->buff_size;
+    if (fs->size > 0 && fs->size - fs->offset < want)
+        want = fs->size - fs->offset;
+
+    ch->len = fbset_read(fs, buff, want, &err);
+    fs->offset += ch->len;
+    ch->err = err;
+    ch->last = (err != 0 || ch->len < want || fbset_at_end(fs));
+
+    if (ch->last)
+    {
+        fbset_close(fs);
+        fs->open = 0;
+        fs->offset = 0;
+        ++fs->next;
+    }
+    return 1;
+}
+/** Reads the next chunk into slot. Returns 0 when there are no files left.
+Reads stop at the size from fstat(), so a small file takes a single read(). */
+//------------------------------------------------------------------------------
+
+#ifdef FBSET_POSIX
+static void * fbset_run(void * arg)
+{
+    fbuff_fileset * fs = arg;
+
+    pthread_mutex_lock(&fs->lock);
+    while (1)
+    {
+        while (!fs->quit && fs->count == fs->depth)
+        {
+            fs->reader_waits = 1;
+            pthread_cond_wait(&fs->room, &fs->lock);
+            fs->reader_waits = 0;
+        }
+
+        if (fs->quit)
+            break;
+
+        int slot = (fs->head + fs->count) % fs->depth;
+        pthread_mutex_unlock(&fs->lock);
+        int filled = fbset_fill(fs, slot);
+        pthread_mutex_lock(&fs->lock);
+
+        if (!filled)
+            fs->done = 1;
+        else
+            ++fs->count;
+
+        if (fs->caller_waits)
+            pthread_cond_signal(&fs->ready);
+        if (!filled)
+            break;
+    }
+    pthread_mutex_unlock(&fs->lock);
+    return NULL;
+}
+/** The slot being filled is past the chunks in the ring, so nobody else
+touches it while the lock is let go. */
+#endif
+//------------------------------------------------------------------------------
+
+int fbuff_fileset_new(fbuff_fileset ** out, const char * const * paths,
+    fbuff_off n, fbuff_off buff_size, int depth)
+{
+    check(NULL == out || (NULL == paths && n > 0) || n < 0 || buff_size < 1 ||
+        depth < 1, FBUFF_BAD_ARG);
+
+    fbuff_fileset * fs = calloc(1, sizeof(*fs));
+    if (NULL == fs)
+        return FBUFF_BAD_ALLOC;
+
+#ifndef FBSET_POSIX
+    depth = 1;
+#endif
+
+    if ((uint64_t)buff_size > SIZE_MAX / (uint64_t)depth ||
+        NULL == (fs->buffs = malloc((size_t)(buff_size * depth))) ||
+        NULL == (fs->chunks = calloc(depth, sizeof(*fs->chunks))))
+    {
+        free(fs->buffs);
+        free(fs);
+        return FBUFF_BAD_ALLOC;
+    }
+
+    fs->paths = paths;
+    fs->n = n;
+    fs->buff_size = buff_size;
+    fs->depth = depth;
+
+#ifdef FBSET_POSIX
+    pthread_mutex_init(&fs->lock, NULL);
+    pthread_cond_init(&fs->room, NULL);
+    pthread_cond_init(&fs->ready, NULL);
+    fs->threaded = (pthread_create(&fs->thread, NULL, fbset_run, fs) == 0);
+#endif
+
+    *out = fs;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_fileset_next(fbuff_fileset * fs, fbuff_chunk * out)
+{
+    check(NULL == fs || NULL == out, FBUFF_BAD_ARG);
+
+#ifdef FBSET_POSIX
+    if (fs->threaded)
+    {
+        int result = 0;
+
+        pthread_mutex_lock(&fs->lock);
+        if (fs->held)
+        {
+            fs->head = (fs->head + 1) % fs->depth;
+            --fs->count;
+            fs->held = 0;
+            if (fs->reader_waits && fs->count <= fs->depth / 2)
+                pthread_cond_signal(&fs->room);
+        }
+
+        while (0 == fs->count && !fs->done)
+        {
+            fs->caller_waits = 1;
+            pthread_cond_wait(&fs->ready, &fs->lock);
+            fs->caller_waits = 0;
+        }
+
+        if (fs->count > 0)
+        {
+            *out = fs->chunks[fs->head];
+            fs->held = 1;
+        }
+        else
+            result = FBUFF_EOF;
+        pthread_mutex_unlock(&fs->lock);
+        return result;
+    }
+#endif
+
+    if (!fbset_fill(fs, 0))
+        return FBUFF_EOF;
+    *out = fs->chunks[0];
+    return 0;
+}
+/** Without the thread the single slot is filled on the calling thread. */
+//------------------------------------------------------------------------------
+
+int fbuff_fileset_free(fbuff_fileset * fs)
+{
+    check(NULL == fs, FBUFF_BAD_ARG);
+
+#ifdef FBSET_POSIX
+    if (fs->threaded)
+    {
+        pthread_mutex_lock(&fs->lock);
+        fs->quit = 1;
+        pthread_cond_signal(&fs->room);
+        pthread_mutex_unlock(&fs->lock);
+        pthread_join(fs->thread, NULL);
+    }
+    pthread_cond_destroy(&fs->ready);
+    pthread_cond_destroy(&fs->room);
+    pthread_mutex_destroy(&fs->lock);
+#endif
+
+    if (fs->open)
+        fbset_close(fs);
+
+    free(fs->chunks);
+    free(fs->buffs);
+    free(fs);
+    return 0;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,81 @@
+/**
+    A pipelined reader of many files
+
+    Reads a list of files one after the other as a sequence of chunks of at
+    most buff_size bytes, so many small files cost no more than their data.
+    A helper thread opens, sizes and reads the next files into a ring of depth
+    buffers, allocated once for the whole list, while the caller works on the
+    current chunk. Files are opened with open() and sized with fstat(), so no
+    stdio stream, buffer or seek is made per file, and a file which fits in a
+    buffer is read with a single read(). On systems without pthreads the files
+    are read with stdio on the calling thread, one chunk per call.
+*/
+
+#ifndef FBSET_H
+#define FBSET_H
+
+#include "fbuff.h"
+
+typedef struct fbuff_fileset fbuff_fileset;
+
+typedef struct fbuff_chunk {
+    fbuff_off index;
+    fbuff_off offset;
+    const byte * data;
+    fbuff_off len;
+    int last;
+    int err;
+} fbuff_chunk;
+/** len bytes at data from offset in the file at index in the paths array.
+last is set for the last chunk of a file, which can be empty, and err is
+FBUFF_FERR when the file couldn't be opened or read. Such a file ends with
+that chunk. */
+
+int fbuff_fileset_new(fbuff_fileset ** out, const char * const * paths,
+    fbuff_off n, fbuff_off buff_size, int depth);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when out is NULL, paths is NULL and n is > 0, n is < 0,
+    buff_size is < 1, or depth is < 1.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    0 on success.
+
+Description: Creates a reader of the n files at paths and sets out pointing to
+it. The helper thread starts on the first files right away, and keeps up to
+depth chunks read ahead, so depth must be at least 2 for reading to overlap
+with the caller. paths must stay valid until fbuff_fileset_free(). When the
+thread can't be created, the files are read on the calling thread.
+*/
+
+int fbuff_fileset_next(fbuff_fileset * fs, fbuff_chunk * out);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fs or out is NULL.
+
+Always
+    FBUFF_EOF when all files have been read.
+    0 on success.
+
+Description: Gives back the chunk from the last call and fills out with the
+next one, waiting for it to be read if needed. The files come in the order
+of paths, each one as chunks of consecutive offsets, the last of them with
+last set. out->data is valid until the next call.
+*/
+
+int fbuff_fileset_free(fbuff_fileset * fs);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fs is NULL.
+
+Always
+    0 on success.
+
+Description: Stops the helper thread, closes the file it has open, and frees
+the reader and its buffers. It can be called before all files are read.
+*/
+#endif
@@ -1,57 +1,2290 @@
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define FBUFF_POSIX
+#define _FILE_OFFSET_BITS 64
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
 #include "fbuff.h"
+#include "fbz.h"
+#include "fbpool.h"
+
+#ifdef FBUFF_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+#ifdef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#define FBUFF_INOTIFY
+#include <sys/inotify.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FBUFF_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#ifdef FBUFF_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FBUFF_ZSTD
+#include <zstd.h>
+#endif
+#ifdef FBUFF_LZ4
+#include <lz4frame.h>
+#endif
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+
+enum {
+    FBUFF_MODE_STDIO,
+    FBUFF_MODE_MMAP,
+    FBUFF_MODE_PREFETCH,
+    FBUFF_MODE_URING,
+    FBUFF_MODE_DIRECT,
+    FBUFF_MODE_ZIP,
+    FBUFF_MODE_STREAM
+};
+/** Values of fbuff.mode. */
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_now(void)
+{
+#ifdef FBUFF_POSIX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (fbuff_off)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    return (fbuff_off)clock() * (1000000000 / CLOCKS_PER_SEC);
+#endif
+}
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_NO_STATS
+#define stats_begin(t)
+#define stats_end(fb, op, t)
+#define stats_read(fb, op, want, got)
+#else
+#define stats_begin(t) fbuff_off t = fbuff_now()
+#define stats_end(fb, op, t) fbuff_stats_op((fb), (op), fbuff_now() - (t))
+#define stats_read(fb, op, want, got) \
+    fbuff_stats_read((fb), (op), (want), (got))
+
+static void fbuff_stats_add(fbuff_off * var, fbuff_off val, int op)
+{
+#ifdef __GNUC__
+    if (FBUFF_OP_READ_AT == op || FBUFF_OP_IO == op)
+    {
+        __atomic_fetch_add(var, val, __ATOMIC_RELAXED);
+        return;
+    }
+#endif
+    *var += val;
+}
+/** fbuff_read_at() can run on many threads at once, so it adds atomically,
+and so do the waits for the file, which it times too. */
+//------------------------------------------------------------------------------
+
+static void fbuff_stats_op(fbuff * fb, int op, fbuff_off ns)
+{
+    fbuff_op_stats * st = &fb->stats.ops[op];
+    int bucket = 0;
+
+#ifdef __GNUC__
+    if (ns > 1)
+        bucket = 63 - __builtin_clzll((unsigned long long)ns);
+#else
+    while ((ns >> (bucket + 1)) > 0)
+        ++bucket;
+#endif
+    if (bucket > FBUFF_STATS_BUCKETS - 1)
+        bucket = FBUFF_STATS_BUCKETS - 1;
+
+    fbuff_stats_add(&st->count, 1, op);
+    fbuff_stats_add(&st->ns, ns, op);
+    fbuff_stats_add(&st->hist[bucket], 1, op);
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_stats_read(fbuff * fb, int op, fbuff_off want, fbuff_off got)
+{
+    if (got < 0)
+        got = 0;
+
+    fbuff_stats_add(&fb->stats.requested, want, op);
+    fbuff_stats_add(&fb->stats.delivered, got, op);
+    if (got < want)
+        fbuff_stats_add(&fb->stats.short_reads, 1, op);
+}
+#endif
+/** Statistics are kept by the public functions and around each wait for the
+file. The macros are empty with FBUFF_NO_STATS, so nothing is left of them. */
+//------------------------------------------------------------------------------
+
+static int fbuff_fseek(FILE * fp, fbuff_off offset, int whence)
+{
+#if defined(FBUFF_POSIX)
+    return fseeko(fp, (off_t)offset, whence);
+#elif defined(_WIN32)
+    return _fseeki64(fp, offset, whence);
+#else
+    return fseek(fp, (long int)offset, whence);
+#endif
+}
+//------------------------------------------------------------------------------
+
+#if !defined(NO_SEEK_END) || !defined(FBUFF_POSIX)
+static fbuff_off fbuff_ftell(FILE * fp)
+{
+#if defined(FBUFF_POSIX)
+    return ftello(fp);
+#elif defined(_WIN32)
+    return _ftelli64(fp);
+#else
+    return ftell(fp);
+#endif
+}
+#endif
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_fread(FILE * fp, byte * buff, fbuff_off nbytes,
+    int * state)
+{
+    fbuff_off read = fread(buff, sizeof(*buff), (size_t)nbytes, fp);
+
+    if (ferror(fp))
+        *state = FBUFF_FERR;
+    if (feof(fp))
+        *state = FBUFF_EOF;
+
+    return read;
+}
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_POSIX
+static fbuff_off fbuff_fdread(int fd, byte * buff, fbuff_off nbytes,
+    int * state)
+{
+    fbuff_off all = 0;
+    while (all < nbytes)
+    {
+        ssize_t read_ = read(fd, buff + all, (size_t)(nbytes - all));
+        if (read_ < 0 && EINTR == errno)
+            continue;
+        if (read_ < 0)
+        {
+            *state = FBUFF_FERR;
+            break;
+        }
+        if (0 == read_)
+        {
+            *state = FBUFF_EOF;
+            break;
+        }
+        all += read_;
+    }
+    return all;
+}
+#endif
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_io_read(fbuff * fb, byte * buff, fbuff_off nbytes,
+    int * state)
+{
+    fbuff_off read = 0;
+    stats_begin(t0);
+
+#ifdef FBUFF_POSIX
+    if (NULL == fb->pfile)
+        read = fbuff_fdread(fb->fd, buff, nbytes, state);
+    else
+#endif
+    read = fbuff_fread(fb->pfile, buff, nbytes, state);
+
+    stats_end(fb, FBUFF_OP_IO, t0);
+    return read;
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_io_seek(fbuff * fb, fbuff_off offset)
+{
+    int err = 0;
+    stats_begin(t0);
+
+#ifdef FBUFF_POSIX
+    if (NULL == fb->pfile)
+        err = (lseek(fb->fd, (off_t)offset, SEEK_SET) < 0) ? -1 : 0;
+    else
+#endif
+    err = fbuff_fseek(fb->pfile, offset, SEEK_SET);
+
+    stats_end(fb, FBUFF_OP_IO, t0);
+    return err;
+}
+/** The stream or file descriptor a fbuff reads from directly. */
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_POSIX
+struct fbuff_prefetch {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    FILE * pfile;
+    byte * buff;
+    fbuff_off want;
+    fbuff_off got;
+    int state;
+    int busy;
+    int pending;
+    int quit;
+};
+/** The helper thread reads want bytes into buff while busy is set. pending
+is only touched by the owning thread and means buff holds, or will hold, the
+next buff_size bytes of the file. */
+
+static void * fbuff_prefetch_run(void * arg)
+{
+    struct fbuff_prefetch * pf = arg;
+
+    pthread_mutex_lock(&pf->lock);
+    while (1)
+    {
+        while (!pf->busy && !pf->quit)
+            pthread_cond_wait(&pf->cond, &pf->lock);
+
+        if (pf->quit)
+            break;
+
+        pthread_mutex_unlock(&pf->lock);
+        int state = 0;
+        fbuff_off got = fbuff_fread(pf->pfile, pf->buff, pf->want, &state);
+        pthread_mutex_lock(&pf->lock);
+
+        pf->got = got;
+        pf->state = state;
+        pf->busy = 0;
+        pthread_cond_broadcast(&pf->cond);
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_prefetch_start(fbuff * fb)
+{
+    struct fbuff_prefetch * pf = fb->pf;
+
+    pthread_mutex_lock(&pf->lock);
+    pf->want = fb->buff_size;
+    pf->busy = 1;
+    pthread_cond_broadcast(&pf->cond);
+    pthread_mutex_unlock(&pf->lock);
+    pf->pending = 1;
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_prefetch_wait(fbuff * fb)
+{
+    struct fbuff_prefetch * pf = fb->pf;
+    stats_begin(t0);
+
+    pthread_mutex_lock(&pf->lock);
+    while (pf->busy)
+        pthread_cond_wait(&pf->cond, &pf->lock);
+    pthread_mutex_unlock(&pf->lock);
+
+    stats_end(fb, FBUFF_OP_IO, t0);
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_prefetch_discard(fbuff * fb)
+{
+    struct fbuff_prefetch * pf = fb->pf;
+
+    if (!pf->pending)
+        return 0;
+
+    fbuff_prefetch_wait(fb);
+    pf->pending = 0;
+    return fbuff_io_seek(fb, fb->pos);
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_prefetch_read(fbuff * fb, fbuff_off nbytes)
+{
+    struct fbuff_prefetch * pf = fb->pf;
+    int state = 0;
+
+    if (pf->pending && nbytes == fb->buff_size)
+    {
+        fbuff_prefetch_wait(fb);
+        pf->pending = 0;
+
+        byte * tmp = fb->data;
+        fb->data = pf->buff;
+        pf->buff = tmp;
+        fb->last_read = pf->got;
+        state = pf->state;
+    }
+    else
+    {
+        if (fbuff_prefetch_discard(fb) != 0)
+            state = FBUFF_FERR;
+        else
+            fb->last_read = fbuff_io_read(fb, fb->data, nbytes, &state);
+    }
+
+    if (state)
+        fb->state = state;
+    else
+        fbuff_prefetch_start(fb);
+
+    fb->data_off = fb->pos;
+    fb->pos += fb->last_read;
+    fb->all_bytes_read += fb->last_read;
+    return fb->last_read;
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_prefetch_free(fbuff * fb)
+{
+    struct fbuff_prefetch * pf = fb->pf;
+
+    pthread_mutex_lock(&pf->lock);
+    pf->quit = 1;
+    pthread_cond_broadcast(&pf->cond);
+    pthread_mutex_unlock(&pf->lock);
+    pthread_join(pf->thread, NULL);
+
+    pthread_cond_destroy(&pf->cond);
+    pthread_mutex_destroy(&pf->lock);
+    free(pf->buff);
+    free(pf);
+}
+#endif
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_POSIX
+static fbuff_off fbuff_pread_full(int fd, byte * buff, fbuff_off nbytes,
+    fbuff_off offset, int * state)
+{
+    fbuff_off all = 0;
+    while (all < nbytes)
+    {
+        ssize_t read = pread(fd, buff + all, (size_t)(nbytes - all),
+            (off_t)(offset + all));
+        if (read < 0 && EINTR == errno)
+            continue;
+        if (read < 0)
+        {
+            *state = FBUFF_FERR;
+            break;
+        }
+        if (0 == read)
+        {
+            *state = FBUFF_EOF;
+            break;
+        }
+        all += read;
+    }
+    return all;
+}
+#endif
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_raw_read_at(fbuff * fb, fbuff_off offset,
+    fbuff_off nbytes, byte * dst)
+{
+    int state = 0;
+    fbuff_off read = 0;
+
+#ifdef FBUFF_POSIX
+    read = fbuff_pread_full(fb->fd, dst, nbytes, offset, &state);
+#else
+    fbuff_off pos = fbuff_ftell(fb->pfile);
+    if (fbuff_fseek(fb->pfile, offset, SEEK_SET) != 0)
+        return FBUFF_FERR;
+    read = fbuff_fread(fb->pfile, dst, nbytes, &state);
+    if (fbuff_fseek(fb->pfile, pos, SEEK_SET) != 0)
+        return FBUFF_FERR;
+#endif
+
+    return (FBUFF_FERR == state) ? FBUFF_FERR : read;
+}
+/** Reads the file itself by offset, whatever the mode of the buffer. */
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_io_read_at(fbuff * fb, fbuff_off offset,
+    fbuff_off nbytes, byte * dst)
+{
+    stats_begin(t0);
+    fbuff_off read = fbuff_raw_read_at(fb, offset, nbytes, dst);
+    stats_end(fb, FBUFF_OP_IO, t0);
+    return read;
+}
+/** fbuff_raw_read_at() counted as a wait for the file. */
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_URING
+struct fbuff_uring {
+    int ring_fd;
+    int fd;
+    unsigned depth;
+    unsigned * sq_tail;
+    unsigned * sq_mask;
+    unsigned * sq_array;
+    struct io_uring_sqe * sqes;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned * cq_mask;
+    struct io_uring_cqe * cqes;
+    void * sq_ring;
+    void * cq_ring;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+    byte ** buffs;
+    fbuff_off * offs;
+    fbuff_off * got;
+    int * done;
+    unsigned head;
+    unsigned inflight;
+    fbuff_off next_off;
+};
+/** Slots head to head+inflight-1 (mod depth) hold reads of consecutive
+buff_size blocks of the file, starting at offs[head]. They are handed to the
+caller in that order, whatever order they complete in. */
+
+#define FBUFF_URING_MAX_READ 0x7ffff000
+/** Linux never transfers more than that in a single read. */
+
+static int fbuff_uring_enter(int ring_fd, unsigned submit, unsigned wait)
+{
+    return syscall(__NR_io_uring_enter, ring_fd, submit, wait,
+        wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_uring_submit(fbuff * fb, unsigned slot, fbuff_off offset)
+{
+    struct fbuff_uring * ur = fb->ur;
+    unsigned tail = *ur->sq_tail;
+    unsigned index = tail & *ur->sq_mask;
+    struct io_uring_sqe * sqe = &ur->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = ur->fd;
+    sqe->addr = (unsigned long)ur->buffs[slot];
+    sqe->len = (unsigned)fb->buff_size;
+    sqe->off = offset;
+    sqe->user_data = slot;
+    ur->sq_array[index] = index;
+    __atomic_store_n(ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ur->offs[slot] = offset;
+    ur->done[slot] = 0;
+    if (fbuff_uring_enter(ur->ring_fd, 1, 0) != 1)
+    {
+        __atomic_store_n(ur->sq_tail, tail, __ATOMIC_RELEASE);
+        return FBUFF_FERR;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_uring_reap(struct fbuff_uring * ur)
+{
+    unsigned head = *ur->cq_head;
+    unsigned tail = __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        struct io_uring_cqe * cqe = &ur->cqes[head & *ur->cq_mask];
+        ur->got[cqe->user_data] = cqe->res;
+        ur->done[cqe->user_data] = 1;
+    }
+    __atomic_store_n(ur->cq_head, head, __ATOMIC_RELEASE);
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_uring_wait(fbuff * fb, unsigned slot)
+{
+    struct fbuff_uring * ur = fb->ur;
+    stats_begin(t0);
+
+    fbuff_uring_reap(ur);
+    while (!ur->done[slot])
+    {
+        fbuff_uring_enter(ur->ring_fd, 0, 1);
+        fbuff_uring_reap(ur);
+    }
+
+    stats_end(fb, FBUFF_OP_IO, t0);
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_uring_fill(fbuff * fb)
+{
+    struct fbuff_uring * ur = fb->ur;
+
+    while (ur->inflight < ur->depth && ur->next_off < fb->file_size)
+    {
+        unsigned slot = (ur->head + ur->inflight) % ur->depth;
+        if (fbuff_uring_submit(fb, slot, ur->next_off) != 0)
+            break;
+        ++ur->inflight;
+        ur->next_off += fb->buff_size;
+    }
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_uring_drain(fbuff * fb)
+{
+    struct fbuff_uring * ur = fb->ur;
+
+    for (; ur->inflight; --ur->inflight, ur->head = (ur->head+1) % ur->depth)
+        fbuff_uring_wait(fb, ur->head);
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_uring_read(fbuff * fb, fbuff_off nbytes)
+{
+    struct fbuff_uring * ur = fb->ur;
+    int state = 0;
+
+    if (ur->inflight && nbytes == fb->buff_size &&
+        ur->offs[ur->head] == fb->pos)
+    {
+        unsigned slot = ur->head;
+        fbuff_uring_wait(fb, slot);
+        ur->head = (ur->head + 1) % ur->depth;
+        --ur->inflight;
+
+        byte * tmp = fb->data;
+        fb->data = ur->buffs[slot];
+        ur->buffs[slot] = tmp;
+
+        fbuff_off got = ur->got[slot];
+        if (got < 0)
+        {
+            state = FBUFF_FERR;
+            got = 0;
+        }
+        else if (got < nbytes)
+        {
+            stats_begin(t0);
+            got += fbuff_pread_full(ur->fd, fb->data + got, nbytes - got,
+                fb->pos + got, &state);
+            stats_end(fb, FBUFF_OP_IO, t0);
+        }
+        fb->last_read = got;
+    }
+    else
+    {
+        fbuff_uring_drain(fb);
+
+        stats_begin(t0);
+        fb->last_read = fbuff_pread_full(ur->fd, fb->data, nbytes, fb->pos,
+            &state);
+        stats_end(fb, FBUFF_OP_IO, t0);
+        ur->next_off = fb->pos + fb->last_read;
+    }
+
+    if (state)
+        fb->state = state;
+    if (state != FBUFF_FERR)
+        fbuff_uring_fill(fb);
+
+    fb->data_off = fb->pos;
+    fb->pos += fb->last_read;
+    fb->all_bytes_read += fb->last_read;
+    return fb->last_read;
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_uring_free(struct fbuff_uring * ur)
+{
+    unsigned i;
+
+    if (ur->sq_ring && ur->sq_ring != MAP_FAILED)
+        munmap(ur->sq_ring, ur->sq_len);
+    if (ur->cq_ring && ur->cq_ring != MAP_FAILED && ur->cq_ring != ur->sq_ring)
+        munmap(ur->cq_ring, ur->cq_len);
+    if (ur->sqes && (void *)ur->sqes != MAP_FAILED)
+        munmap(ur->sqes, ur->sqes_len);
+    if (ur->ring_fd >= 0)
+        close(ur->ring_fd);
+
+    if (ur->buffs)
+        for (i = 0; i < ur->depth; ++i)
+            free(ur->buffs[i]);
+
+    free(ur->buffs);
+    free(ur->offs);
+    free(ur->got);
+    free(ur->done);
+    free(ur);
+}
+//------------------------------------------------------------------------------
+
+static struct fbuff_uring * fbuff_uring_new(int fd, fbuff_off buff_size,
+    unsigned depth)
+{
+    struct io_uring_params p;
+    struct fbuff_uring * ur = calloc(1, sizeof(*ur));
+    unsigned i;
+
+    if (NULL == ur)
+        return NULL;
+
+    ur->fd = fd;
+    ur->depth = depth;
+    memset(&p, 0, sizeof(p));
+    if ((ur->ring_fd = syscall(__NR_io_uring_setup, depth, &p)) < 0)
+        goto fail;
+
+    ur->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ur->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ur->cq_len > ur->sq_len)
+            ur->sq_len = ur->cq_len;
+        ur->cq_len = ur->sq_len;
+    }
+
+    ur->sq_ring = mmap(NULL, ur->sq_len, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ur->sq_ring)
+        goto fail;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ur->cq_ring = ur->sq_ring;
+    else
+        ur->cq_ring = mmap(NULL, ur->cq_len, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_CQ_RING);
+    if (MAP_FAILED == ur->cq_ring)
+        goto fail;
+
+    ur->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ur->sqes = mmap(NULL, ur->sqes_len, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == (void *)ur->sqes)
+        goto fail;
+
+    byte * sq = ur->sq_ring;
+    byte * cq = ur->cq_ring;
+    ur->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ur->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ur->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ur->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ur->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ur->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ur->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    ur->buffs = calloc(depth, sizeof(*ur->buffs));
+    ur->offs = calloc(depth, sizeof(*ur->offs));
+    ur->got = calloc(depth, sizeof(*ur->got));
+    ur->done = calloc(depth, sizeof(*ur->done));
+    if (!ur->buffs || !ur->offs || !ur->got || !ur->done)
+        goto fail;
+
+    for (i = 0; i < depth; ++i)
+        if (NULL == (ur->buffs[i] = malloc((size_t)buff_size)))
+            goto fail;
+
+    return ur;
+
+fail:
+    fbuff_uring_free(ur);
+    return NULL;
+}
+#endif
+//------------------------------------------------------------------------------
+
+#if defined(FBUFF_POSIX) && defined(O_DIRECT)
+#define FBUFF_DIRECT
+#define FBUFF_DIRECT_ALIGN 4096
+
+struct fbuff_direct {
+    int fd;
+    fbuff_off align;
+    byte * base;
+};
+/** base is an align aligned buffer of buff_size rounded up to align, plus one
+more block for an unaligned start. data points inside it. */
+
+static fbuff_off fbuff_direct_read(fbuff * fb, fbuff_off nbytes)
+{
+    struct fbuff_direct * dio = fb->dio;
+    fbuff_off start = fb->pos - fb->pos % dio->align;
+    fbuff_off end = fb->pos + nbytes;
+    fbuff_off got = 0;
+
+    if (end > fb->file_size)
+        end = fb->file_size;
+    end += (dio->align - end % dio->align) % dio->align;
+
+    stats_begin(t0);
+    while (start + got < end)
+    {
+        ssize_t read = pread(dio->fd, dio->base + got,
+            (size_t)(end - start - got), (off_t)(start + got));
+        if (read < 0 && EINTR == errno)
+            continue;
+        if (read < 0)
+        {
+            fb->state = FBUFF_FERR;
+            break;
+        }
+        got += read;
+        if (0 == read || got % dio->align != 0)
+            break;
+    }
+    stats_end(fb, FBUFF_OP_IO, t0);
+
+    fbuff_off avail = got - (fb->pos - start);
+    if (avail < 0)
+        avail = 0;
+
+    fb->data = dio->base + (fb->pos - start);
+    fb->last_read = (nbytes < avail) ? nbytes : avail;
+    if (fb->last_read < nbytes && fb->state != FBUFF_FERR)
+        fb->state = FBUFF_EOF;
+
+    fb->data_off = fb->pos;
+    fb->pos += fb->last_read;
+    fb->all_bytes_read += fb->last_read;
+    return fb->last_read;
+}
+#endif
+//------------------------------------------------------------------------------
+
+struct fbuff_cache {
+    fbuff_off block_size;
+    int nslots;
+    int hand;
+    byte * blocks;
+    fbuff_off * tags;
+    fbuff_off * lens;
+    byte * ref;
+    int * next;
+    int * buckets;
+    fbuff_off hits;
+    fbuff_off misses;
+};
+/** nslots blocks of block_size bytes. tags holds the block number of the file
+in each slot, -1 when empty. Slots are found through buckets chained by next
+and evicted in CLOCK order using the ref bits. */
+
+static void fbuff_cache_free(struct fbuff_cache * ca)
+{
+    if (NULL == ca)
+        return;
+
+    free(ca->blocks);
+    free(ca->tags);
+    free(ca->lens);
+    free(ca->ref);
+    free(ca->next);
+    free(ca->buckets);
+    free(ca);
+}
+//------------------------------------------------------------------------------
+
+static struct fbuff_cache * fbuff_cache_new(fbuff_off block_size,
+    fbuff_off budget)
+{
+    fbuff_off nslots = budget / block_size;
+    int i;
+
+    if (nslots < 1)
+        nslots = 1;
+    if (nslots > 0x7fffffff || (uint64_t)(nslots * block_size) > SIZE_MAX)
+        return NULL;
+
+    struct fbuff_cache * ca = calloc(1, sizeof(*ca));
+    if (NULL == ca)
+        return NULL;
+
+    ca->block_size = block_size;
+    ca->nslots = (int)nslots;
+    ca->blocks = malloc((size_t)(nslots * block_size));
+    ca->tags = malloc(nslots * sizeof(*ca->tags));
+    ca->lens = calloc(nslots, sizeof(*ca->lens));
+    ca->ref = calloc(nslots, sizeof(*ca->ref));
+    ca->next = malloc(nslots * sizeof(*ca->next));
+    ca->buckets = malloc(nslots * sizeof(*ca->buckets));
+    if (!ca->blocks || !ca->tags || !ca->lens || !ca->ref || !ca->next ||
+        !ca->buckets)
+    {
+        fbuff_cache_free(ca);
+        return NULL;
+    }
+
+    for (i = 0; i < ca->nslots; ++i)
+    {
+        ca->tags[i] = -1;
+        ca->next[i] = -1;
+        ca->buckets[i] = -1;
+    }
+    return ca;
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_cache_unlink(struct fbuff_cache * ca, int slot)
+{
+    int * link = &ca->buckets[ca->tags[slot] % ca->nslots];
+
+    while (*link != slot)
+        link = &ca->next[*link];
+    *link = ca->next[slot];
+    ca->tags[slot] = -1;
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_cache_get(fbuff * fb, fbuff_off block)
+{
+    struct fbuff_cache * ca = fb->cache;
+    int bucket = block % ca->nslots;
+    int slot;
+
+    for (slot = ca->buckets[bucket]; slot >= 0; slot = ca->next[slot])
+    {
+        if (ca->tags[slot] == block)
+        {
+            ca->ref[slot] = 1;
+            ++ca->hits;
+            return slot;
+        }
+    }
+
+    ++ca->misses;
+    while (ca->ref[ca->hand])
+    {
+        ca->ref[ca->hand] = 0;
+        ca->hand = (ca->hand + 1) % ca->nslots;
+    }
+    slot = ca->hand;
+    ca->hand = (ca->hand + 1) % ca->nslots;
+
+    if (ca->tags[slot] >= 0)
+        fbuff_cache_unlink(ca, slot);
+
+    fbuff_off got = fbuff_io_read_at(fb, block * ca->block_size,
+        ca->block_size, ca->blocks + slot * ca->block_size);
+    if (got < 0)
+        return FBUFF_FERR;
+
+    ca->tags[slot] = block;
+    ca->lens[slot] = got;
+    ca->ref[slot] = 1;
+    ca->next[slot] = ca->buckets[bucket];
+    ca->buckets[bucket] = slot;
+    return slot;
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_cache_read(fbuff * fb, fbuff_off nbytes)
+{
+    struct fbuff_cache * ca = fb->cache;
+    fbuff_off done = 0;
+
+    while (done < nbytes && fb->pos + done < fb->file_size)
+    {
+        fbuff_off offset = fb->pos + done;
+        fbuff_off block = offset / ca->block_size;
+        int slot = fbuff_cache_get(fb, block);
+
+        if (slot < 0)
+        {
+            fb->state = FBUFF_FERR;
+            break;
+        }
+
+        fbuff_off in = offset - block * ca->block_size;
+        fbuff_off len = ca->lens[slot] - in;
+        if (len <= 0)
+            break;
+        if (len > nbytes - done)
+            len = nbytes - done;
+
+        memcpy(fb->data + done, ca->blocks + slot * ca->block_size + in,
+            (size_t)len);
+        done += len;
+    }
+
+    if (done < nbytes && fb->state != FBUFF_FERR)
+        fb->state = FBUFF_EOF;
+
+    fb->last_read = done;
+    fb->data_off = fb->pos;
+    fb->pos += done;
+    fb->all_bytes_read += done;
+    return done;
+}
+//------------------------------------------------------------------------------
+
+enum {
+    FBUFF_ZIP_NONE,
+    FBUFF_ZIP_GZIP,
+    FBUFF_ZIP_ZSTD,
+    FBUFF_ZIP_LZ4,
+    FBUFF_ZIP_FBZ
+};
+/** Compression formats told apart by their magic bytes. */
+
+#define FBUFF_ZIP_IN_SIZE (64 * 1024)
+#define FBUFF_ZIP_MAX_OUT 0x40000000
+
+struct fbuff_zip {
+    int kind;
+    int end;
+    int done;
+    byte * in;
+    fbuff_off in_off;
+    fbuff_off in_pos;
+    fbuff_off in_len;
+    byte * skip;
+#ifdef FBUFF_ZLIB
+    z_stream zs;
+#endif
+#ifdef FBUFF_ZSTD
+    ZSTD_DStream * zd;
+#endif
+#ifdef FBUFF_LZ4
+    LZ4F_dctx * lz;
+#endif
+    int codec;
+    fbuff_off * index;
+    fbuff_off nblocks;
+    fbuff_off block_size;
+    fbuff_off block;
+    byte * out;
+    fbuff_off out_len;
+};
+/** in holds in_len bytes of compressed data read from before in_off, the
+first in_pos of which are decoded. end is set when the last frame decoded is
+complete, done when the file ends right after it. skip is scratch space for
+the data fbuff_set_offset() jumps over. For fbz files, in holds the
+compressed block, out the out_len bytes of the block number block, and
+index the offsets of the blocks in the file. */
+
+static int fbuff_zip_kind(const byte * magic, fbuff_off len)
+{
+    static const byte gzip[] = {0x1f, 0x8b};
+    static const byte zstd[] = {0x28, 0xb5, 0x2f, 0xfd};
+    static const byte lz4[] = {0x04, 0x22, 0x4d, 0x18};
+
+    if (len >= 2 && 0 == memcmp(magic, gzip, sizeof(gzip)))
+        return FBUFF_ZIP_GZIP;
+    if (len >= 4 && 0 == memcmp(magic, zstd, sizeof(zstd)))
+        return FBUFF_ZIP_ZSTD;
+    if (len >= 4 && 0 == memcmp(magic, lz4, sizeof(lz4)))
+        return FBUFF_ZIP_LZ4;
+    if (len >= FBZ_MAGIC_LEN && 0 == memcmp(magic, FBZ_MAGIC, FBZ_MAGIC_LEN))
+        return FBUFF_ZIP_FBZ;
+    return FBUFF_ZIP_NONE;
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_zip_free(struct fbuff_zip * zip)
+{
+    if (NULL == zip)
+        return;
+
+#ifdef FBUFF_ZLIB
+    if (FBUFF_ZIP_GZIP == zip->kind)
+        inflateEnd(&zip->zs);
+#endif
+#ifdef FBUFF_ZSTD
+    ZSTD_freeDStream(zip->zd);
+#endif
+#ifdef FBUFF_LZ4
+    if (zip->lz)
+        LZ4F_freeDecompressionContext(zip->lz);
+#endif
+    free(zip->in);
+    free(zip->skip);
+    free(zip->index);
+    free(zip->out);
+    free(zip);
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_zip_new(fbuff * fb, int kind)
+{
+    struct fbuff_zip * zip = calloc(1, sizeof(*zip));
+    int ok = 0;
+
+    if (NULL == zip)
+        return FBUFF_BAD_ALLOC;
+
+    zip->in = malloc(FBUFF_ZIP_IN_SIZE);
+    zip->skip = malloc(FBUFF_ZIP_IN_SIZE);
+    if (NULL == zip->in || NULL == zip->skip)
+    {
+        fbuff_zip_free(zip);
+        return FBUFF_BAD_ALLOC;
+    }
+
+#ifdef FBUFF_ZLIB
+    if (FBUFF_ZIP_GZIP == kind)
+        ok = (Z_OK == inflateInit2(&zip->zs, 15 + 16));
+#endif
+#ifdef FBUFF_ZSTD
+    if (FBUFF_ZIP_ZSTD == kind)
+        ok = (zip->zd = ZSTD_createDStream()) != NULL &&
+            !ZSTD_isError(ZSTD_initDStream(zip->zd));
+#endif
+#ifdef FBUFF_LZ4
+    if (FBUFF_ZIP_LZ4 == kind)
+        ok = !LZ4F_isError(LZ4F_createDecompressionContext(&zip->lz,
+            LZ4F_VERSION));
+#endif
+    if (FBUFF_ZIP_FBZ == kind)
+        ok = 1;
+
+    if (!ok)
+    {
+        fbuff_zip_free(zip);
+        return FBUFF_FERR;
+    }
+
+    zip->kind = kind;
+    fb->zip = zip;
+    return 0;
+}
+/** Returns FBUFF_FERR when the decoder for kind is not compiled in. */
+//------------------------------------------------------------------------------
+
+static int fbuff_zip_fill(fbuff * fb)
+{
+    struct fbuff_zip * zip = fb->zip;
+    fbuff_off got = fbuff_io_read_at(fb, zip->in_off, FBUFF_ZIP_IN_SIZE,
+        zip->in);
+
+    if (got < 0)
+        return FBUFF_FERR;
+
+    zip->in_off += got;
+    zip->in_pos = 0;
+    zip->in_len = got;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_zip_rewind(struct fbuff_zip * zip)
+{
+    zip->in_off = zip->in_pos = zip->in_len = 0;
+    zip->end = zip->done = 0;
+
+#ifdef FBUFF_ZLIB
+    if (FBUFF_ZIP_GZIP == zip->kind)
+        return (Z_OK == inflateReset(&zip->zs)) ? 0 : FBUFF_FERR;
+#endif
+#ifdef FBUFF_ZSTD
+    if (FBUFF_ZIP_ZSTD == zip->kind)
+        return ZSTD_isError(ZSTD_initDStream(zip->zd)) ? FBUFF_FERR : 0;
+#endif
+#ifdef FBUFF_LZ4
+    if (FBUFF_ZIP_LZ4 == zip->kind)
+        LZ4F_resetDecompressionContext(zip->lz);
+#endif
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_zip_step(struct fbuff_zip * zip, byte * dst, fbuff_off cap,
+    fbuff_off * made)
+{
+    if (cap > FBUFF_ZIP_MAX_OUT)
+        cap = FBUFF_ZIP_MAX_OUT;
+
+#ifdef FBUFF_ZLIB
+    if (FBUFF_ZIP_GZIP == zip->kind)
+    {
+        uInt src_len = (uInt)(zip->in_len - zip->in_pos);
+
+        zip->zs.next_in = zip->in + zip->in_pos;
+        zip->zs.avail_in = src_len;
+        zip->zs.next_out = dst;
+        zip->zs.avail_out = (uInt)cap;
+
+        int ret = inflate(&zip->zs, Z_NO_FLUSH);
+        zip->in_pos += src_len - zip->zs.avail_in;
+        *made = cap - zip->zs.avail_out;
+
+        if (Z_STREAM_END == ret)
+            return 1;
+        return (Z_OK == ret || Z_BUF_ERROR == ret) ? 0 : FBUFF_FERR;
+    }
+#endif
+#ifdef FBUFF_ZSTD
+    if (FBUFF_ZIP_ZSTD == zip->kind)
+    {
+        ZSTD_inBuffer in = {zip->in + zip->in_pos,
+            (size_t)(zip->in_len - zip->in_pos), 0};
+        ZSTD_outBuffer out = {dst, (size_t)cap, 0};
+
+        size_t ret = ZSTD_decompressStream(zip->zd, &out, &in);
+        zip->in_pos += in.pos;
+        *made = out.pos;
+
+        if (ZSTD_isError(ret))
+            return FBUFF_FERR;
+        return 0 == ret;
+    }
+#endif
+#ifdef FBUFF_LZ4
+    if (FBUFF_ZIP_LZ4 == zip->kind)
+    {
+        size_t src_len = (size_t)(zip->in_len - zip->in_pos);
+        size_t out_len = (size_t)cap;
+
+        size_t ret = LZ4F_decompress(zip->lz, dst, &out_len,
+            zip->in + zip->in_pos, &src_len, NULL);
+        zip->in_pos += src_len;
+        *made = out_len;
+
+        if (LZ4F_isError(ret))
+            return FBUFF_FERR;
+        return 0 == ret;
+    }
+#endif
+    return FBUFF_FERR;
+}
+/** Decodes what it can from in into at most cap bytes of dst. Returns 1 when
+a frame has ended, 0 when there is more to do. */
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_get_u64(const byte * src)
+{
+    uint64_t val = 0;
+    int i;
+
+    for (i = 7; i >= 0; --i)
+        val = (val << 8) | src[i];
+    return (val > INT64_MAX) ? -1 : (fbuff_off)val;
+}
+/** Little endian, -1 for values fbuff_off can't hold. */
+//------------------------------------------------------------------------------
+
+static int fbuff_fbz_open(fbuff * fb)
+{
+    struct fbuff_zip * zip = fb->zip;
+    fbuff_off raw_size = fb->file_size;
+    byte head[FBZ_HEADER_SIZE];
+    byte tail[FBZ_TRAILER_SIZE];
+    fbuff_off i, max = 0;
+
+    if (raw_size < FBZ_HEADER_SIZE + FBZ_TRAILER_SIZE ||
+        fbuff_raw_read_at(fb, 0, FBZ_HEADER_SIZE, head) != FBZ_HEADER_SIZE ||
+        fbuff_raw_read_at(fb, raw_size - FBZ_TRAILER_SIZE, FBZ_TRAILER_SIZE,
+            tail) != FBZ_TRAILER_SIZE ||
+        memcmp(tail + 32, FBZ_MAGIC, FBZ_MAGIC_LEN) != 0)
+        return FBUFF_FERR;
+
+    zip->codec = head[FBZ_MAGIC_LEN];
+#ifndef FBUFF_ZLIB
+    if (FBZ_ZLIB == zip->codec)
+        return FBUFF_FERR;
+#endif
+#ifndef FBUFF_ZSTD
+    if (FBZ_ZSTD == zip->codec)
+        return FBUFF_FERR;
+#endif
+    if (zip->codec != FBZ_ZLIB && zip->codec != FBZ_ZSTD)
+        return FBUFF_FERR;
+
+    fbuff_off block_size = fbuff_get_u64(tail);
+    fbuff_off data_size = fbuff_get_u64(tail + 8);
+    fbuff_off nblocks = fbuff_get_u64(tail + 16);
+    fbuff_off index_off = fbuff_get_u64(tail + 24);
+
+    if (block_size < 1 || data_size < 0 || nblocks < 0 ||
+        (uint64_t)block_size > SIZE_MAX ||
+        nblocks != data_size / block_size + (data_size % block_size != 0) ||
+        index_off < FBZ_HEADER_SIZE ||
+        (raw_size - FBZ_TRAILER_SIZE - index_off) / 8 != nblocks + 1 ||
+        (raw_size - FBZ_TRAILER_SIZE - index_off) % 8 != 0)
+        return FBUFF_FERR;
+
+    fbuff_off index_len = (nblocks + 1) * 8;
+    byte * raw = malloc((size_t)index_len);
+    zip->index = malloc((size_t)(nblocks + 1) * sizeof(*zip->index));
+    zip->out = malloc((size_t)block_size);
+    if (NULL == raw || NULL == zip->index || NULL == zip->out)
+    {
+        free(raw);
+        return FBUFF_BAD_ALLOC;
+    }
+
+    if (fbuff_raw_read_at(fb, index_off, index_len, raw) != index_len)
+    {
+        free(raw);
+        return FBUFF_FERR;
+    }
+
+    for (i = 0; i <= nblocks; ++i)
+    {
+        zip->index[i] = fbuff_get_u64(raw + i * 8);
+        if (i > 0 && zip->index[i] - zip->index[i-1] > max)
+            max = zip->index[i] - zip->index[i-1];
+        if ((0 == i && zip->index[i] != FBZ_HEADER_SIZE) ||
+            (i > 0 && zip->index[i] < zip->index[i-1]) ||
+            (i == nblocks && zip->index[i] != index_off))
+        {
+            free(raw);
+            return FBUFF_FERR;
+        }
+    }
+    free(raw);
+
+    if (max > FBUFF_ZIP_IN_SIZE)
+    {
+        free(zip->in);
+        if ((uint64_t)max > SIZE_MAX || NULL == (zip->in = malloc((size_t)max)))
+            return FBUFF_BAD_ALLOC;
+    }
+
+    zip->nblocks = nblocks;
+    zip->block_size = block_size;
+    zip->block = -1;
+    fb->file_size = data_size;
+    return 0;
+}
+/** Reads and checks the trailer and the index. */
+//------------------------------------------------------------------------------
+
+static int fbuff_fbz_load(fbuff * fb, fbuff_off block)
+{
+    struct fbuff_zip * zip = fb->zip;
+    fbuff_off start = zip->index[block];
+    fbuff_off len = zip->index[block+1] - start;
+    fbuff_off want = fb->file_size - block * zip->block_size;
+    int ok = 0;
+
+    if (want > zip->block_size)
+        want = zip->block_size;
+
+    zip->block = -1;
+    if (fbuff_io_read_at(fb, start, len, zip->in) != len)
+        return FBUFF_FERR;
+
+#ifdef FBUFF_ZLIB
+    if (FBZ_ZLIB == zip->codec)
+    {
+        uLongf out_len = (uLongf)zip->block_size;
+        ok = Z_OK == uncompress(zip->out, &out_len, zip->in, (uLong)len) &&
+            (fbuff_off)out_len == want;
+    }
+#endif
+#ifdef FBUFF_ZSTD
+    if (FBZ_ZSTD == zip->codec)
+    {
+        size_t out_len = ZSTD_decompress(zip->out, (size_t)zip->block_size,
+            zip->in, (size_t)len);
+        ok = !ZSTD_isError(out_len) && (fbuff_off)out_len == want;
+    }
+#endif
+
+    if (!ok)
+        return FBUFF_FERR;
+
+    zip->block = block;
+    zip->out_len = want;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_fbz_read(fbuff * fb, byte * dst, fbuff_off nbytes,
+    int * state)
+{
+    struct fbuff_zip * zip = fb->zip;
+    fbuff_off done = 0;
+
+    while (done < nbytes)
+    {
+        fbuff_off offset = fb->pos + done;
+        fbuff_off block = offset / zip->block_size;
+
+        if (offset >= fb->file_size)
+        {
+            *state = FBUFF_EOF;
+            break;
+        }
+
+        if (block != zip->block && fbuff_fbz_load(fb, block) != 0)
+        {
+            *state = FBUFF_FERR;
+            break;
+        }
+
+        fbuff_off in = offset - block * zip->block_size;
+        fbuff_off len = zip->out_len - in;
+        if (len > nbytes - done)
+            len = nbytes - done;
+
+        memcpy(dst + done, zip->out + in, (size_t)len);
+        done += len;
+    }
+    return done;
+}
+/** The last block decoded is kept, so reads and seeks inside it don't
+decompress it again. */
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_zip_read(fbuff * fb, byte * dst, fbuff_off nbytes,
+    int * state)
+{
+    struct fbuff_zip * zip = fb->zip;
+    fbuff_off done = 0;
+
+    if (FBUFF_ZIP_FBZ == zip->kind)
+        return fbuff_fbz_read(fb, dst, nbytes, state);
+
+    while (done < nbytes && !zip->done)
+    {
+        if (zip->in_pos == zip->in_len && fbuff_zip_fill(fb) != 0)
+        {
+            *state = FBUFF_FERR;
+            return done;
+        }
+
+        int dry = (zip->in_pos == zip->in_len);
+        if (zip->end)
+        {
+            if (dry || (FBUFF_ZIP_GZIP == zip->kind &&
+                zip->in[zip->in_pos] != 0x1f))
+            {
+                zip->done = 1;
+                break;
+            }
+#ifdef FBUFF_ZLIB
+            if (FBUFF_ZIP_GZIP == zip->kind)
+                inflateReset(&zip->zs);
+#endif
+            zip->end = 0;
+        }
+
+        fbuff_off made = 0;
+        int ret = fbuff_zip_step(zip, dst + done, nbytes - done, &made);
+        done += made;
+
+        if (ret < 0 || (dry && 0 == made && 0 == ret))
+        {
+            *state = FBUFF_FERR;
+            return done;
+        }
+        zip->end = ret;
+    }
+
+    if (zip->done)
+    {
+        fb->file_size = fb->pos + done;
+        if (done < nbytes)
+            *state = FBUFF_EOF;
+    }
+    return done;
+}
+/** Frames follow each other until the file ends, like with the command line
+tools. Data after the last gzip member is ignored. A file which ends inside a
+frame is an error. */
+//------------------------------------------------------------------------------
+
+static int fbuff_zip_seek(fbuff * fb, fbuff_off offset)
+{
+    struct fbuff_zip * zip = fb->zip;
+
+    if (FBUFF_ZIP_FBZ == zip->kind)
+    {
+        fb->pos = offset;
+        return 0;
+    }
+
+    if (offset < fb->pos)
+    {
+        if (fbuff_zip_rewind(zip) != 0)
+        {
+            fb->state = FBUFF_FERR;
+            return FBUFF_FERR;
+        }
+        fb->pos = 0;
+    }
+
+    while (fb->pos < offset)
+    {
+        fbuff_off want = offset - fb->pos;
+        int state = 0;
+
+        if (want > FBUFF_ZIP_IN_SIZE)
+            want = FBUFF_ZIP_IN_SIZE;
+
+        fbuff_off got = fbuff_zip_read(fb, zip->skip, want, &state);
+        fb->pos += got;
+
+        if (FBUFF_FERR == state)
+        {
+            fb->state = FBUFF_FERR;
+            return FBUFF_FERR;
+        }
+        if (got < want)
+            return FBUFF_BAD_OFFSET;
+    }
+    return 0;
+}
+/** Decodes forward from the current position, or from the start of the file
+when going back. fbz files need no decoding to seek. */
+//------------------------------------------------------------------------------
+
+#if defined(FBUFF_ZSTD) || defined(FBUFF_LZ4)
+static uint32_t fbuff_le(const byte * b, int n)
+{
+    uint32_t v = 0;
+    while (n-- > 0)
+        v = (v << 8) | b[n];
+    return v;
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_zip_one_frame(fbuff * fb, int kind)
+{
+    static const int zstd_did[] = {0, 1, 2, 4};
+    static const int zstd_fcs[] = {0, 2, 4, 8};
+    byte hd[5];
+    fbuff_off off, size = fb->file_size;
+
+    if (size < 0 || fbuff_raw_read_at(fb, 0, sizeof(hd), hd) != sizeof(hd))
+        return 0;
+
+    int flg = hd[4];
+    if (FBUFF_ZIP_ZSTD == kind)
+    {
+        int single = (flg >> 5) & 1;
+        off = 5 + !single + zstd_did[flg & 3] +
+            ((flg >> 6) ? zstd_fcs[flg >> 6] : single);
+    }
+    else
+        off = 7 + ((flg & 0x08) ? 8 : 0) + ((flg & 0x01) ? 4 : 0);
+
+    while (off < size)
+    {
+        byte bh[4];
+        int hlen = (FBUFF_ZIP_ZSTD == kind) ? 3 : 4;
+        if (fbuff_raw_read_at(fb, off, hlen, bh) != hlen)
+            return 0;
+
+        uint32_t h = fbuff_le(bh, hlen);
+        off += hlen;
+        if (FBUFF_ZIP_ZSTD == kind)
+        {
+            if (3 == ((h >> 1) & 3))
+                return 0;
+            off += (1 == ((h >> 1) & 3)) ? 1 : (h >> 3);
+            if (h & 1)
+                return off + ((flg & 0x04) ? 4 : 0) == size;
+        }
+        else
+        {
+            if (0 == h)
+                return off + ((flg & 0x04) ? 4 : 0) == size;
+            off += (h & 0x7fffffff) + ((flg & 0x10) ? 4 : 0);
+        }
+    }
+    return 0;
+}
+/** Tells whether the file is a single zstd or lz4 frame, by walking the block
+headers of the first one with reads of a few bytes, up to where it ends. */
+//------------------------------------------------------------------------------
+#endif
+
+static fbuff_off fbuff_zip_size(fbuff * fb)
+{
+    fbuff_off size = FBUFF_NO_SIZE;
+#ifdef FBUFF_ZSTD
+    if (FBUFF_ZIP_ZSTD == fb->zip->kind)
+    {
+        unsigned long long csize = ZSTD_getFrameContentSize(fb->zip->in,
+            (size_t)fb->zip->in_len);
+        if (csize != ZSTD_CONTENTSIZE_UNKNOWN &&
+            csize != ZSTD_CONTENTSIZE_ERROR && csize <= INT64_MAX)
+            size = (fbuff_off)csize;
+    }
+#endif
+#ifdef FBUFF_LZ4
+    if (FBUFF_ZIP_LZ4 == fb->zip->kind)
+    {
+        LZ4F_frameInfo_t info;
+        size_t len = (size_t)(fb->zip->in_len - fb->zip->in_pos);
+
+        if (!LZ4F_isError(LZ4F_getFrameInfo(fb->zip->lz, &info,
+            fb->zip->in + fb->zip->in_pos, &len)))
+        {
+            fb->zip->in_pos += len;
+            if (info.contentSize > 0 && info.contentSize <= INT64_MAX)
+                size = (fbuff_off)info.contentSize;
+        }
+    }
+#endif
+#if defined(FBUFF_ZSTD) || defined(FBUFF_LZ4)
+    if (size >= 0 && !fbuff_zip_one_frame(fb, fb->zip->kind))
+        size = FBUFF_NO_SIZE;
+#endif
+    return size;
+}
+/** The content size from the header of the first frame, if it has one and
+it is the only frame in the file. Called while file_size is still the size of
+the compressed file. */
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_POSIX
+static void fbuff_advise_range(fbuff * fb, int advice, fbuff_off offset,
+    fbuff_off len)
+{
+    static const int fadv[] = {
+        POSIX_FADV_NORMAL,
+        POSIX_FADV_SEQUENTIAL,
+        POSIX_FADV_RANDOM,
+        POSIX_FADV_WILLNEED,
+        POSIX_FADV_DONTNEED
+    };
+    static const int madv[] = {
+        MADV_NORMAL,
+        MADV_SEQUENTIAL,
+        MADV_RANDOM,
+        MADV_WILLNEED,
+        MADV_DONTNEED
+    };
+
+    if (FBUFF_MODE_ZIP == fb->mode)
+    {
+        if (advice <= FBUFF_ADV_RANDOM)
+            posix_fadvise(fb->fd, 0, 0, fadv[advice]);
+        return;
+    }
+
+    if (FBUFF_MODE_MMAP != fb->mode)
+    {
+        posix_fadvise(fb->fd, (off_t)offset, (off_t)len,
+            fadv[advice]);
+        return;
+    }
+
+    if (NULL == fb->map)
+        return;
+
+    fbuff_off page = sysconf(_SC_PAGESIZE);
+    fbuff_off start = offset - offset % page;
+    fbuff_off end = (0 == len || offset + len > fb->file_size) ?
+        fb->file_size : offset + len;
+
+    if (end > start)
+        madvise(fb->map + start, (size_t)(end - start), madv[advice]);
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_advise_consumed(fbuff * fb)
+{
+    fbuff_off page = sysconf(_SC_PAGESIZE);
+    fbuff_off end = fb->data_off - fb->data_off % page;
+
+    if (fb->adv_done < end)
+    {
+        fbuff_advise_range(fb, FBUFF_ADV_DONTNEED, fb->adv_done,
+            end - fb->adv_done);
+        fb->adv_done = end;
+    }
+
+    if (fb->pos < fb->file_size)
+        fbuff_advise_range(fb, FBUFF_ADV_WILLNEED, fb->pos, fb->buff_size);
+}
+/** Drops the whole pages before the buffer from the page cache and asks for
+the next buffer to be read ahead. */
+#endif
+//------------------------------------------------------------------------------
+
+static void fbuff_predict(fbuff * fb, fbuff_off nbytes)
+{
+    fbuff_off stride = fb->data_off - fb->pat_off;
+    fbuff_off prev_len = fb->pat_len;
+    int was = fb->pattern;
+
+    fb->pat_len = nbytes;
+    if (fb->pat_off < 0)
+    {
+        fb->pat_off = fb->data_off;
+        return;
+    }
+    fb->pat_off = fb->data_off;
+
+    if (stride == prev_len)
+    {
+        fb->pattern = FBUFF_PAT_SEQUENTIAL;
+        fb->pat_stride = stride;
+        return;
+    }
+
+    if (0 == stride || stride != fb->pat_stride)
+    {
+        fb->pattern = FBUFF_PAT_NONE;
+        fb->pat_stride = stride;
+        return;
+    }
+
+    fb->pattern = (stride > 0) ? FBUFF_PAT_STRIDED : FBUFF_PAT_REVERSE;
+
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_ZIP == fb->mode || FBUFF_MODE_DIRECT == fb->mode)
+        return;
+
+    int k = (was != fb->pattern) ? 1 : FBUFF_PREDICT_DEPTH;
+    for (; k <= FBUFF_PREDICT_DEPTH; ++k)
+    {
+        fbuff_off offset = fb->data_off + k * stride;
+        if (offset < 0 || offset >= fb->file_size)
+            break;
+        fbuff_advise_range(fb, FBUFF_ADV_WILLNEED, offset, nbytes);
+    }
+#else
+    (void)was;
+#endif
+}
+/** Follows the starts of the reads. When a stride is first seen repeated,
+the next FBUFF_PREDICT_DEPTH regions along it are read ahead, after that only
+the one at the far end, since the others were asked for by the reads
+before. */
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_POSIX
+struct fbuff_follow {
+    int timeout;
+    int ino;
+    int linked;
+    int rotated;
+};
+/** Follow mode. ino is the inotify instance watching the file, -1 without
+one. linked is whether the file had a name to begin with, so an unnamed one
+doesn't look deleted. */
+//------------------------------------------------------------------------------
+
+static void fbuff_follow_free(struct fbuff_follow * fl)
+{
+    if (NULL == fl)
+        return;
+    if (fl->ino >= 0)
+        close(fl->ino);
+    free(fl);
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_follow_check(fbuff * fb)
+{
+    struct stat st;
+
+    if (fstat(fb->fd, &st) != 0)
+        return FBUFF_FERR;
+
+    if (st.st_size != fb->pos)
+    {
+        fb->file_size = st.st_size;
+        return (st.st_size < fb->pos) ? FBUFF_TRUNCATED : 1;
+    }
+
+    if (fb->follow->rotated || (fb->follow->linked && 0 == st.st_nlink))
+        return FBUFF_ROTATED;
+    return 0;
+}
+/** Returns 1 when there is more data, 0 when there isn't yet, and the return
+code of fbuff_read() when following has to stop. */
+//------------------------------------------------------------------------------
+
+static void fbuff_follow_wait(fbuff * fb, int ms)
+{
+    struct fbuff_follow * fl = fb->follow;
+
+#ifdef FBUFF_INOTIFY
+    if (fl->ino >= 0)
+    {
+        union {
+            struct inotify_event ev;
+            char buff[4096];
+        } evs;
+        struct pollfd pfd;
+        ssize_t len;
+        char * p;
+        const struct inotify_event * ev;
+
+        pfd.fd = fl->ino;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, ms) <= 0)
+            return;
+
+        while ((len = read(fl->ino, evs.buff, sizeof(evs.buff))) > 0)
+        {
+            for (p = evs.buff; p < evs.buff + len; p += sizeof(*ev) + ev->len)
+            {
+                ev = (const struct inotify_event *)p;
+                if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))
+                    fl->rotated = 1;
+            }
+        }
+        return;
+    }
+#endif
+
+    if (ms < 0 || ms > FBUFF_FOLLOW_POLL_MS)
+        ms = FBUFF_FOLLOW_POLL_MS;
+    poll(NULL, 0, ms);
+}
+/** Waits for the file to change, at most ms milliseconds, forever if ms is
+< 0. Without inotify it sleeps a little, and the size is checked again. The
+waits are for the writer of the file, so they are not timed as I/O. */
+#endif
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_stream_read(fbuff * fb, fbuff_off nbytes)
+{
+    fbuff_off keep = fb->ahead;
+
+    if (keep > 0 && fb->pos != fb->data_off)
+        memmove(fb->data, fb->data + (fb->pos - fb->data_off), (size_t)keep);
+
+    if (keep >= nbytes)
+    {
+        fb->last_read = nbytes;
+        fb->ahead = keep - nbytes;
+    }
+    else
+    {
+        fb->last_read = keep +
+            fbuff_io_read(fb, fb->data + keep, nbytes - keep, &fb->state);
+        fb->ahead = 0;
+    }
+
+    fb->data_off = fb->pos;
+    fb->pos += fb->last_read;
+    fb->all_bytes_read += fb->last_read;
+
+    if (FBUFF_EOF == fb->state)
+        fb->file_size = fb->pos + fb->ahead;
+    return fb->last_read;
+}
+/** The ahead bytes at pos in the buffer were read from the stream already,
+before a set offset went back. They are moved to the front and given out
+first. The size of the stream is known once its end is read. */
+//------------------------------------------------------------------------------
+
+static int fbuff_stream_seek(fbuff * fb, fbuff_off offset)
+{
+    fbuff_off end = fb->pos + fb->ahead;
+
+    if (offset < end)
+    {
+        if (offset < fb->data_off)
+            return FBUFF_BAD_OFFSET;
+
+        fb->ahead = end - offset;
+        fb->pos = offset;
+        return 0;
+    }
+
+    fb->pos = end;
+    fb->ahead = 0;
+    while (fb->pos < offset)
+    {
+        fbuff_off want = offset - fb->pos;
+        int state = 0;
+
+        if (want > fb->buff_size)
+            want = fb->buff_size;
+
+        fbuff_off got = fbuff_io_read(fb, fb->data, want, &state);
+        fb->pos += got;
+        fb->data_off = fb->pos;
+        fb->last_read = 0;
+
+        if (FBUFF_FERR == state)
+        {
+            fb->state = FBUFF_FERR;
+            return FBUFF_FERR;
+        }
+        if (got < want)
+        {
+            fb->file_size = fb->pos;
+            return FBUFF_BAD_OFFSET;
+        }
+    }
+    return 0;
+}
+/** Going back works only within the data still in the buffer. Going forward
+reads and drops the data up to offset. */
+//------------------------------------------------------------------------------
+
+static int fbuff_seeks_stream(fbuff * fb)
+{
+    return NULL == fb->cache && FBUFF_MODE_MMAP != fb->mode &&
+        FBUFF_MODE_URING != fb->mode && FBUFF_MODE_DIRECT != fb->mode &&
+        FBUFF_MODE_ZIP != fb->mode;
+}
+//------------------------------------------------------------------------------
+
+static int fbuff_check_offset(fbuff * fb, fbuff_off * offset)
+{
+    if (*offset < 0)
+    {
+        if (fb->file_size < 0)
+            return FBUFF_BAD_OFFSET;
+        *offset += fb->file_size;
+    }
+
+    if (*offset < 0 || (fb->file_size >= 0 && *offset > fb->file_size))
+        return FBUFF_BAD_OFFSET;
+    return 0;
+}
+/** Turns a negative offset into one from the start of the file. Offsets past
+the end can't be told while the file size is not known. */
+//------------------------------------------------------------------------------
+
+static int fbuff_seek(fbuff * fb, fbuff_off offset)
+{
+    if (fbuff_check_offset(fb, &offset) != 0)
+        return FBUFF_BAD_OFFSET;
+
+    if (FBUFF_MODE_STREAM == fb->mode)
+        return fbuff_stream_seek(fb, offset);
+    if (FBUFF_MODE_ZIP == fb->mode)
+        return fbuff_zip_seek(fb, offset);
+
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_PREFETCH == fb->mode)
+        fbuff_prefetch_discard(fb);
+#endif
+#ifdef FBUFF_URING
+    if (FBUFF_MODE_URING == fb->mode)
+    {
+        fbuff_uring_drain(fb);
+        fb->ur->next_off = offset;
+    }
+#endif
+
+    if (fbuff_seeks_stream(fb) &&
+        fbuff_io_seek(fb, offset) != 0)
+    {
+        fb->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+
+    fb->pos = offset;
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_PREFETCH == fb->mode && fb->state != FBUFF_FERR)
+        fbuff_prefetch_start(fb);
+#endif
+#ifdef FBUFF_URING
+    if (FBUFF_MODE_URING == fb->mode && fb->state != FBUFF_FERR)
+        fbuff_uring_fill(fb);
+#endif
+    return 0;
+}
+/** fbuff_set_offset() without the statistics, also used on init. */
+//------------------------------------------------------------------------------
+
+static int fbuff_get_fsize(fbuff * fb)
+{
+    fbuff_off fsize = 0;
+
+#if defined(FBUFF_POSIX)
+    struct stat st;
+    if (fstat(fb->fd, &st) != 0)
+    {
+        fb->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+
+    if (!S_ISREG(st.st_mode) && lseek(fb->fd, 0, SEEK_CUR) < 0)
+    {
+        fb->mode = FBUFF_MODE_STREAM;
+        fb->file_size = FBUFF_NO_SIZE;
+        return 0;
+    }
+
+    if (S_ISREG(st.st_mode) || NULL == fb->pfile)
+    {
+        fsize = S_ISREG(st.st_mode) ? st.st_size : lseek(fb->fd, 0, SEEK_END);
+        if (fsize < 0 || fbuff_seek(fb, 0) != 0)
+        {
+            fb->state = FBUFF_FERR;
+            return FBUFF_FERR;
+        }
+        fb->file_size = fsize;
+        return 0;
+    }
+#elif defined(_WIN32)
+    struct _stati64 st;
+    if (0 == _fstati64(_fileno(fb->pfile), &st) &&
+        _S_IFREG == (st.st_mode & _S_IFMT))
+    {
+        if (fbuff_seek(fb, 0) != 0)
+        {
+            fb->state = FBUFF_FERR;
+            return FBUFF_FERR;
+        }
+        fb->file_size = st.st_size;
+        return 0;
+    }
+#endif
+
+#ifdef NO_SEEK_END
+    size_t read = 0;
+    while ((read = fread(fb->data, sizeof(*(fb->data)), fb->buff_size,
+            fb->pfile)) > 0)
+        fsize += read;
+#else
+    if (fbuff_fseek(fb->pfile, 0, SEEK_END) != 0)
+    {
+        fb->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+    fsize = fbuff_ftell(fb->pfile);
+#endif
+
+    if (ferror(fb->pfile) || fbuff_seek(fb, 0) != 0)
+    {
+        fb->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+    fb->file_size = fsize;
+    return 0;
+}
+/** Regular files are sized with fstat(), so init costs the same for any file
+size. Inputs which can't seek, like pipes and sockets, are read as streams of
+unknown size. The file is only read through, or seeked to its end, for the
+rest, like block devices, or where there is no fstat(). */
+//------------------------------------------------------------------------------
+
+static int fbuff_fileno(FILE * fp)
+{
+#ifdef FBUFF_POSIX
+    return fileno(fp);
+#else
+    return -1;
+#endif
+}
+//------------------------------------------------------------------------------
+
+static void fbuff_zero(fbuff * pfb, FILE * fp, int fd)
+{
+    pfb->pfile = fp;
+    pfb->fd = fd;
+    pfb->file_size = 0;
+    pfb->state = 0;
+    pfb->data = NULL;
+    pfb->buff_size = 0;
+    pfb->last_read = 0;
+    pfb->all_bytes_read = 0;
+    pfb->mode = FBUFF_MODE_STDIO;
+    pfb->map = NULL;
+    pfb->pos = 0;
+    pfb->data_off = 0;
+    pfb->ahead = 0;
+    pfb->pf = NULL;
+    pfb->ur = NULL;
+    pfb->cache = NULL;
+    pfb->dio = NULL;
+    pfb->zip = NULL;
+    pfb->advice = FBUFF_ADV_NORMAL;
+    pfb->adv_done = 0;
+    pfb->pattern = FBUFF_PAT_NONE;
+    pfb->pat_off = -1;
+    pfb->pat_len = 0;
+    pfb->pat_stride = 0;
+    pfb->tune = NULL;
+    pfb->follow = NULL;
+    pfb->pool = NULL;
+    pfb->pool_size = 0;
+    memset(&pfb->stats, 0, sizeof(pfb->stats));
+}
+//------------------------------------------------------------------------------
+
+int fbuff_init(fbuff * pfb, FILE * fp, fbuff_off buff_size)
+{
+    check(NULL == pfb || NULL == fp || buff_size < 1, FBUFF_BAD_ARG);
+    fbuff_zero(pfb, fp, fbuff_fileno(fp));
+
+    if ((uint64_t)buff_size > SIZE_MAX ||
+        NULL == (pfb->data = malloc((size_t)buff_size)))
+        return FBUFF_BAD_ALLOC;
+     pfb->buff_size = buff_size;
+
+    if (fbuff_get_fsize(pfb) < 0)
+    {
+        fbuff_free(pfb);
+        return FBUFF_FERR;
+    }
+
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_init_fd(fbuff * pfb, int fd, fbuff_off buff_size)
+{
+#ifdef FBUFF_POSIX
+    check(NULL == pfb || fd < 0 || buff_size < 1, FBUFF_BAD_ARG);
+    fbuff_zero(pfb, NULL, fd);
+
+    if ((uint64_t)buff_size > SIZE_MAX ||
+        NULL == (pfb->data = malloc((size_t)buff_size)))
+        return FBUFF_BAD_ALLOC;
+    pfb->buff_size = buff_size;
+
+    if (fbuff_get_fsize(pfb) < 0)
+    {
+        fbuff_free(pfb);
+        return FBUFF_FERR;
+    }
+
+    return 0;
+#else
+    return FBUFF_FERR;
+#endif
+}
+//------------------------------------------------------------------------------
+
+int fbuff_init_mmap(fbuff * pfb, FILE * fp, fbuff_off buff_size)
+{
+#ifdef FBUFF_POSIX
+    check(NULL == pfb || NULL == fp || buff_size < 1, FBUFF_BAD_ARG);
+    fbuff_zero(pfb, fp, fbuff_fileno(fp));
+
+    struct stat st;
+    if (fstat(pfb->fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        pfb->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+
+    if ((uint64_t)st.st_size > SIZE_MAX)
+        return FBUFF_BAD_ALLOC;
+
+    if (st.st_size > 0)
+    {
+        void * map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+            pfb->fd, 0);
+        if (MAP_FAILED == map)
+        {
+            pfb->state = FBUFF_FERR;
+            return FBUFF_FERR;
+        }
+        pfb->map = map;
+    }
 
-#ifdef FBUFF_NO_CHECKS
-#define check(expr, val)
+    pfb->mode = FBUFF_MODE_MMAP;
+    pfb->data = pfb->map;
+    pfb->buff_size = buff_size;
+    pfb->file_size = st.st_size;
+    return 0;
 #else
-#define check(expr, val) while (expr) return (val)
+    return fbuff_init(pfb, fp, buff_size);
 #endif
+}
 //------------------------------------------------------------------------------
 
-static long int fbuff_get_fsize(fbuff * fb)
+int fbuff_init_prefetch(fbuff * pfb, FILE * fp, fbuff_off buff_size)
 {
-    check(NULL == fb, FBUFF_BAD_ARG);
+    int err = fbuff_init(pfb, fp, buff_size);
+    if (err != 0)
+        return err;
 
-    long int fsize = 0;
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_STREAM == pfb->mode)
+        return 0;
 
-#ifdef NO_SEEK_END
-    long int read = 0;
-    while ((read = fread(fb->data, sizeof(*(fb->data)), fb->buff_size,
-            fb->pfile)) > 0)
-        fsize += read;
+    struct fbuff_prefetch * pf = calloc(1, sizeof(*pf));
+    if (NULL == pf || NULL == (pf->buff = malloc((size_t)buff_size)))
+    {
+        free(pf);
+        fbuff_free(pfb);
+        return FBUFF_BAD_ALLOC;
+    }
+
+    pf->pfile = fp;
+    pthread_mutex_init(&pf->lock, NULL);
+    pthread_cond_init(&pf->cond, NULL);
+    if (pthread_create(&pf->thread, NULL, fbuff_prefetch_run, pf) != 0)
+    {
+        pthread_cond_destroy(&pf->cond);
+        pthread_mutex_destroy(&pf->lock);
+        free(pf->buff);
+        free(pf);
+        return 0;
+    }
+
+    pfb->pf = pf;
+    pfb->mode = FBUFF_MODE_PREFETCH;
+    fbuff_prefetch_start(pfb);
+#endif
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_init_uring(fbuff * pfb, FILE * fp, fbuff_off buff_size, int depth)
+{
+    check(depth < 1, FBUFF_BAD_ARG);
+
+    int err = fbuff_init(pfb, fp, buff_size);
+    if (err != 0)
+        return err;
+
+#ifdef FBUFF_URING
+    if (buff_size > FBUFF_URING_MAX_READ || FBUFF_MODE_STREAM == pfb->mode)
+        return 0;
+
+    struct fbuff_uring * ur = fbuff_uring_new(pfb->fd, buff_size, depth);
+    if (NULL == ur)
+        return 0;
+
+    pfb->ur = ur;
+    pfb->mode = FBUFF_MODE_URING;
+    fbuff_uring_fill(pfb);
+#endif
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_init_direct(fbuff * pfb, FILE * fp, fbuff_off buff_size)
+{
+#ifdef FBUFF_DIRECT
+    check(NULL == pfb || NULL == fp || buff_size < 1, FBUFF_BAD_ARG);
+    fbuff_zero(pfb, fp, fbuff_fileno(fp));
+
+    struct stat st;
+    char path[64];
+    if (fstat(pfb->fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        pfb->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", pfb->fd);
+    int fd = open(path, O_RDONLY | O_DIRECT);
+    if (fd < 0)
+        return fbuff_init(pfb, fp, buff_size);
+
+    struct fbuff_direct * dio = calloc(1, sizeof(*dio));
+    fbuff_off align = FBUFF_DIRECT_ALIGN;
+    fbuff_off cap = buff_size + (align - buff_size % align) % align + align;
+    void * base = NULL;
+
+    if (NULL == dio || (uint64_t)cap > SIZE_MAX ||
+        posix_memalign(&base, (size_t)align, (size_t)cap) != 0)
+    {
+        free(dio);
+        close(fd);
+        return FBUFF_BAD_ALLOC;
+    }
+
+    dio->fd = fd;
+    dio->align = align;
+    dio->base = base;
+
+    pfb->dio = dio;
+    pfb->mode = FBUFF_MODE_DIRECT;
+    pfb->data = base;
+    pfb->buff_size = buff_size;
+    pfb->file_size = st.st_size;
+    return 0;
 #else
-    fseek(fb->pfile, 0, SEEK_END);
-    fsize = ftell(fb->pfile);
+    return fbuff_init(pfb, fp, buff_size);
 #endif
+}
+//------------------------------------------------------------------------------
+
+int fbuff_init_decomp(fbuff * pfb, FILE * fp, fbuff_off buff_size)
+{
+    int err = fbuff_init(pfb, fp, buff_size);
+    if (err != 0)
+        return err;
 
-    if (ferror(fb->pfile) || fbuff_set_offset(fb, 0) != 0)
+    if (FBUFF_MODE_STREAM == pfb->mode)
     {
-        fb->state = FBUFF_FERR;
+        fbuff_free(pfb);
         return FBUFF_FERR;
     }
-    fb->file_size = fsize;
-    return fsize;
+
+    byte magic[4];
+    fbuff_off got = fbuff_raw_read_at(pfb, 0, sizeof(magic), magic);
+    if (got < 0)
+    {
+        fbuff_free(pfb);
+        return FBUFF_FERR;
+    }
+
+    int kind = fbuff_zip_kind(magic, got);
+    if (FBUFF_ZIP_NONE == kind)
+        return 0;
+
+    if ((err = fbuff_zip_new(pfb, kind)) == 0)
+        err = (FBUFF_ZIP_FBZ == kind) ? fbuff_fbz_open(pfb) :
+            fbuff_zip_fill(pfb);
+
+    if (err != 0)
+    {
+        fbuff_free(pfb);
+        return err;
+    }
+
+    pfb->mode = FBUFF_MODE_ZIP;
+    if (kind != FBUFF_ZIP_FBZ)
+        pfb->file_size = fbuff_zip_size(pfb);
+    return 0;
 }
 //------------------------------------------------------------------------------
 
-int fbuff_init(fbuff * pfb, FILE * fp, int buff_size)
+int fbuff_init_pool(fbuff * pfb, FILE * fp, fbuff_off buff_size,
+    struct fbuff_pool * pool)
 {
-    check(NULL == pfb || NULL == fp || buff_size < 1, FBUFF_BAD_ARG);
-    pfb->pfile = fp;
-    pfb->file_size = 0;
-    pfb->state = 0;
-    pfb->buff_size = 0;
-    pfb->last_read = 0;
-    pfb->all_bytes_read = 0;
+    check(NULL == pfb || NULL == fp || NULL == pool || buff_size < 1 ||
+        buff_size > FBPOOL_MAX_SIZE, FBUFF_BAD_ARG);
+    fbuff_zero(pfb, fp, fbuff_fileno(fp));
 
-    if (NULL == (pfb->data = malloc(buff_size)))
-        return FBUFF_BAD_ALLOC;
-     pfb->buff_size = buff_size;
+    int err = fbuff_pool_get(pool, buff_size, &pfb->data);
+    if (err != 0)
+        return err;
+    pfb->pool = pool;
+    pfb->pool_size = buff_size;
+    pfb->buff_size = buff_size;
 
     if (fbuff_get_fsize(pfb) < 0)
+    {
+        fbuff_free(pfb);
         return FBUFF_FERR;
+    }
 
     return 0;
 }
@@ -60,31 +2293,252 @@ int fbuff_init(fbuff * pfb, FILE * fp, int buff_size)
 int fbuff_free(fbuff * fb)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
-    free(fb->data);
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_PREFETCH == fb->mode)
+        fbuff_prefetch_free(fb);
+#endif
+#ifdef FBUFF_URING
+    if (FBUFF_MODE_URING == fb->mode)
+    {
+        fbuff_uring_drain(fb);
+        fbuff_uring_free(fb->ur);
+    }
+#endif
+    fbuff_cache_free(fb->cache);
+    fbuff_zip_free(fb->zip);
+    free(fb->tune);
+#ifdef FBUFF_POSIX
+    fbuff_follow_free(fb->follow);
+#endif
+#ifdef FBUFF_DIRECT
+    if (FBUFF_MODE_DIRECT == fb->mode)
+    {
+        close(fb->dio->fd);
+        free(fb->dio->base);
+        free(fb->dio);
+    }
+    else
+#endif
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_MMAP == fb->mode)
+    {
+        if (fb->map)
+            munmap(fb->map, fb->file_size);
+    }
+    else
+#endif
+    if (fb->pool)
+        fbuff_pool_put(fb->pool, fb->data, fb->pool_size);
+    else
+        free(fb->data);
     memset(fb, 0, sizeof(*fb));
     return 0;
 }
 //------------------------------------------------------------------------------
 
-int fbuff_read(fbuff * fb, int nbytes)
+static fbuff_off fbuff_read_mode(fbuff * fb, fbuff_off nbytes)
 {
-    if (FBUFF_FILL == nbytes)
-        nbytes = fb->buff_size;
+    if (FBUFF_MODE_MMAP == fb->mode)
+    {
+        fbuff_off avail = fb->file_size - fb->pos;
+        fb->last_read = (nbytes < avail) ? nbytes : avail;
+        fb->data = fb->map + fb->pos;
 
-    check(NULL == fb || nbytes < 0 || nbytes > fb->buff_size, FBUFF_BAD_ARG);
+        if (fb->last_read < nbytes)
+            fb->state = FBUFF_EOF;
 
-    fb->last_read = fread(fb->data, sizeof(*(fb->data)), nbytes, fb->pfile);
+        fb->data_off = fb->pos;
+        fb->pos += fb->last_read;
+        fb->all_bytes_read += fb->last_read;
+        return fb->last_read;
+    }
 
-    if (ferror(fb->pfile))
-        fb->state = FBUFF_FERR;
-    if (feof(fb->pfile))
-        fb->state = FBUFF_EOF;
+    if (fb->cache)
+        return fbuff_cache_read(fb, nbytes);
+
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_PREFETCH == fb->mode)
+        return fbuff_prefetch_read(fb, nbytes);
+#endif
+#ifdef FBUFF_URING
+    if (FBUFF_MODE_URING == fb->mode)
+        return fbuff_uring_read(fb, nbytes);
+#endif
+#ifdef FBUFF_DIRECT
+    if (FBUFF_MODE_DIRECT == fb->mode)
+        return fbuff_direct_read(fb, nbytes);
+#endif
+    if (FBUFF_MODE_STREAM == fb->mode)
+        return fbuff_stream_read(fb, nbytes);
 
+    if (FBUFF_MODE_ZIP == fb->mode)
+        fb->last_read = fbuff_zip_read(fb, fb->data, nbytes, &fb->state);
+    else
+        fb->last_read = fbuff_io_read(fb, fb->data, nbytes, &fb->state);
+
+    fb->data_off = fb->pos;
+    fb->pos += fb->last_read;
     fb->all_bytes_read += fb->last_read;
     return fb->last_read;
 }
 //------------------------------------------------------------------------------
 
+struct fbuff_auto {
+    fbuff_off min;
+    fbuff_off max;
+    fbuff_off cap;
+    fbuff_off run;
+    fbuff_off bytes;
+    fbuff_off ns;
+    fbuff_off prev_size;
+    fbuff_off prev_bytes;
+    fbuff_off prev_ns;
+};
+/** Adaptive buffer size. cap is where growing stops, max unless a bigger size
+was measured slower. run counts the bytes read since the last jump of the
+file position, bytes and ns the full reads done at the current size, and the
+prev_ fields those at the size before it. */
+//------------------------------------------------------------------------------
+
+static fbuff_off fbuff_auto_read(fbuff * fb, fbuff_off nbytes)
+{
+    struct fbuff_auto * at = fb->tune;
+    fbuff_off t0 = fbuff_now();
+    fbuff_off read = fbuff_read_mode(fb, nbytes);
+
+    if (read < nbytes)
+        return read;
+
+    at->run += read;
+    at->bytes += read;
+    at->ns += fbuff_now() - t0;
+
+    if (at->bytes < 2 * fb->buff_size || fb->buff_size >= at->cap)
+        return read;
+
+    if (at->prev_ns > 0 && at->ns > 0 &&
+        4.0 * at->bytes * at->prev_ns < 3.0 * at->prev_bytes * at->ns)
+    {
+        fb->buff_size = at->cap = at->prev_size;
+    }
+    else
+    {
+        at->prev_size = fb->buff_size;
+        at->prev_bytes = at->bytes;
+        at->prev_ns = at->ns;
+        fb->buff_size = (2 * fb->buff_size < at->cap) ?
+            2 * fb->buff_size : at->cap;
+    }
+
+    at->bytes = at->ns = 0;
+    return read;
+}
+/** Grows the buffer after two full FBUFF_FILL reads at the current size,
+unless those moved the bytes over a quarter slower than the reads at the size
+before, in which case it goes back to that size and stays there. */
+//------------------------------------------------------------------------------
+
+static void fbuff_auto_jump(fbuff * fb)
+{
+    struct fbuff_auto * at = fb->tune;
+
+    if (at->run <= fb->buff_size)
+    {
+        fb->buff_size = (fb->buff_size / 2 > at->min) ?
+            fb->buff_size / 2 : at->min;
+        at->cap = at->max;
+        at->prev_ns = 0;
+    }
+    at->run = at->bytes = at->ns = 0;
+}
+/** A jump after no more than a buffer of data looks like random access, so
+the buffer shrinks and may grow back to max again. */
+//------------------------------------------------------------------------------
+
+#ifdef FBUFF_POSIX
+static fbuff_off fbuff_follow_read(fbuff * fb, fbuff_off nbytes,
+    fbuff_off read)
+{
+    struct fbuff_follow * fl = fb->follow;
+    fbuff_off deadline = fbuff_now() + (fbuff_off)fl->timeout * 1000000;
+
+    while (1)
+    {
+        if (fb->pos > fb->file_size)
+            fb->file_size = fb->pos;
+        if (fb->state != FBUFF_EOF)
+            return read;
+
+        fb->state = 0;
+        if (fb->pfile)
+            clearerr(fb->pfile);
+        if (read > 0)
+            return read;
+
+        int more, late = 0;
+        while (0 == (more = fbuff_follow_check(fb)))
+        {
+            if (late)
+            {
+                fb->state = FBUFF_EOF;
+                return 0;
+            }
+
+            fbuff_off left = (deadline - fbuff_now()) / 1000000;
+            if (left < 0)
+                left = 0;
+            fbuff_follow_wait(fb, (fl->timeout < 0 || left > INT_MAX) ?
+                -1 : (int)left);
+            late = (fl->timeout >= 0 && fbuff_now() >= deadline);
+        }
+
+        if (more < 0)
+        {
+            if (FBUFF_FERR == more)
+                fb->state = FBUFF_FERR;
+            return more;
+        }
+        read = fbuff_read_mode(fb, nbytes);
+    }
+}
+/** Called after every read while following. When it came up short at eof,
+goes on checking, waiting and reading again until there is some data, the
+time is up or the file is gone. The file is checked once more after the last
+wait, which also takes in the pending inotify events when there is no time
+to wait. */
+#endif
+//------------------------------------------------------------------------------
+
+fbuff_off fbuff_read(fbuff * fb, fbuff_off nbytes)
+{
+    int fill = (FBUFF_FILL == nbytes);
+    if (fill)
+        nbytes = fb->buff_size;
+
+    check(NULL == fb || nbytes < 0 ||
+        nbytes > (fb->tune ? fb->tune->max : fb->buff_size), FBUFF_BAD_ARG);
+
+    stats_begin(t0);
+    fbuff_off read = (fill && fb->tune) ? fbuff_auto_read(fb, nbytes) :
+        fbuff_read_mode(fb, nbytes);
+
+#ifdef FBUFF_POSIX
+    if (fb->follow)
+        read = fbuff_follow_read(fb, nbytes, read);
+#endif
+
+    if (read > 0 && fb->advice != FBUFF_ADV_RANDOM)
+        fbuff_predict(fb, nbytes);
+#ifdef FBUFF_POSIX
+    if (FBUFF_ADV_SEQUENTIAL == fb->advice && read > 0)
+        fbuff_advise_consumed(fb);
+#endif
+    stats_read(fb, FBUFF_OP_READ, nbytes, read);
+    stats_end(fb, FBUFF_OP_READ, t0);
+    return read;
+}
+//------------------------------------------------------------------------------
+
 int fbuff_reset(fbuff * fb)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
@@ -93,22 +2547,268 @@ int fbuff_reset(fbuff * fb)
 }
 //------------------------------------------------------------------------------
 
-int fbuff_set_offset(fbuff * fb, long int offset)
+int fbuff_set_offset(fbuff * fb, fbuff_off offset)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
 
-    if (offset < 0)
-        offset = fb->file_size + offset;
+    fbuff_off from = fb->pos;
+    stats_begin(t0);
+    int err = fbuff_seek(fb, offset);
+    stats_end(fb, FBUFF_OP_SEEK, t0);
+
+    if (fb->tune && 0 == err && fb->pos != from)
+        fbuff_auto_jump(fb);
+    return err;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_advise(fbuff * fb, int advice, fbuff_off offset, fbuff_off len)
+{
+    check(NULL == fb || advice < FBUFF_ADV_NORMAL ||
+        advice > FBUFF_ADV_DONTNEED || len < 0, FBUFF_BAD_ARG);
 
-    if (offset < 0 || offset > fb->file_size)
+    if (fbuff_check_offset(fb, &offset) != 0)
         return FBUFF_BAD_OFFSET;
 
-    if(fseek(fb->pfile, offset, SEEK_SET) != 0)
+    if (advice <= FBUFF_ADV_RANDOM)
     {
-        fb->state = FBUFF_FERR;
+        fb->advice = advice;
+        fb->adv_done = fb->data_off;
+        fb->pattern = FBUFF_PAT_NONE;
+        fb->pat_off = -1;
+    }
+
+#ifdef FBUFF_POSIX
+    fbuff_advise_range(fb, advice, offset, len);
+#endif
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_pattern(fbuff * fb)
+{
+    check(NULL == fb, FBUFF_BAD_ARG);
+    return fb->pattern;
+}
+//------------------------------------------------------------------------------
+
+fbuff_off fbuff_get_offset(fbuff * fb)
+{
+    check(NULL == fb, FBUFF_BAD_ARG);
+    return fb->pos;
+}
+//------------------------------------------------------------------------------
+
+fbuff_off fbuff_get(fbuff * fb, fbuff_off offset, fbuff_off len, byte ** ptr)
+{
+    check(NULL == fb || NULL == ptr || len < 0 || len > fb->buff_size,
+        FBUFF_BAD_ARG);
+
+    if (fbuff_check_offset(fb, &offset) != 0)
+        return FBUFF_BAD_OFFSET;
+
+    if (fb->file_size >= 0 && offset + len > fb->file_size)
+        len = fb->file_size - offset;
+
+    if (FBUFF_MODE_MMAP == fb->mode)
+    {
+        *ptr = fb->map + offset;
+        return len;
+    }
+
+    if (offset < fb->data_off || offset + len > fb->data_off + fb->last_read)
+    {
+        fbuff_off start = offset - fb->buff_size / 4;
+        if (start + fb->buff_size < offset + len)
+            start = offset + len - fb->buff_size;
+        if (start < 0)
+            start = 0;
+        if (FBUFF_MODE_STREAM == fb->mode && start < fb->data_off &&
+            offset >= fb->data_off)
+            start = fb->data_off;
+
+        stats_begin(t0);
+        int err = fbuff_seek(fb, start);
+        stats_end(fb, FBUFF_OP_SEEK, t0);
+        if (err != 0)
+            return err;
+        if (fbuff_read(fb, FBUFF_FILL) < 0 || FBUFF_FERR == fb->state)
+            return FBUFF_FERR;
+
+        if (offset < fb->data_off || offset > fb->data_off + fb->last_read)
+            return FBUFF_BAD_OFFSET;
+        if (offset + len > fb->data_off + fb->last_read)
+            len = fb->data_off + fb->last_read - offset;
+    }
+
+    *ptr = fb->data + (offset - fb->data_off);
+    return len;
+}
+/** Seeks without fbuff_set_offset(), so the buffer size the window was placed
+with is not halved by fbuff_set_auto() before the window is read. */
+//------------------------------------------------------------------------------
+
+fbuff_off fbuff_read_at(fbuff * fb, fbuff_off offset, fbuff_off nbytes,
+    byte * dst)
+{
+    check(NULL == fb || NULL == dst || nbytes < 0, FBUFF_BAD_ARG);
+
+    if (FBUFF_MODE_ZIP == fb->mode || FBUFF_MODE_STREAM == fb->mode)
+        return FBUFF_BAD_ARG;
+
+    if (fbuff_check_offset(fb, &offset) != 0)
+        return FBUFF_BAD_OFFSET;
+
+    fbuff_off read = 0;
+    stats_begin(t0);
+
+#ifdef FBUFF_POSIX
+    if (FBUFF_MODE_MMAP == fb->mode)
+    {
+        fbuff_off avail = fb->file_size - offset;
+        read = (nbytes < avail) ? nbytes : avail;
+        if (read > 0)
+            memcpy(dst, fb->map + offset, (size_t)read);
+    }
+    else
+#endif
+    read = fbuff_io_read_at(fb, offset, nbytes, dst);
+
+    stats_read(fb, FBUFF_OP_READ_AT, nbytes, read);
+    stats_end(fb, FBUFF_OP_READ_AT, t0);
+    return read;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_set_cache(fbuff * fb, fbuff_off block_size, fbuff_off budget)
+{
+    check(NULL == fb || block_size < 1 || budget < 0 ||
+        (budget > 0 && budget < block_size), FBUFF_BAD_ARG);
+    check(FBUFF_MODE_STDIO != fb->mode || fb->follow, FBUFF_BAD_ARG);
+
+    fbuff_cache_free(fb->cache);
+    fb->cache = NULL;
+
+    if (0 == budget)
+        return fbuff_set_offset(fb, fb->pos);
+
+    if (NULL == (fb->cache = fbuff_cache_new(block_size, budget)))
+        return FBUFF_BAD_ALLOC;
+
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_set_auto(fbuff * fb, fbuff_off min_size, fbuff_off max_size)
+{
+    check(NULL == fb || min_size < 1 || max_size < min_size, FBUFF_BAD_ARG);
+    check(FBUFF_MODE_STDIO != fb->mode && FBUFF_MODE_STREAM != fb->mode,
+        FBUFF_BAD_ARG);
+
+    struct fbuff_auto * at = NULL;
+    byte * data = NULL;
+
+    if (min_size < max_size && NULL == (at = calloc(1, sizeof(*at))))
+        return FBUFF_BAD_ALLOC;
+
+    if (fb->pool)
+    {
+        if (max_size > fbuff_pool_class(fb->pool_size))
+        {
+            free(at);
+            return FBUFF_BAD_ARG;
+        }
+        data = fb->data;
+    }
+    else if ((uint64_t)max_size > SIZE_MAX ||
+        NULL == (data = realloc(fb->data, (size_t)max_size)))
+    {
+        free(at);
+        return FBUFF_BAD_ALLOC;
+    }
+
+    free(fb->tune);
+    fb->tune = at;
+    fb->data = data;
+
+    if (fb->buff_size < min_size)
+        fb->buff_size = min_size;
+    if (fb->buff_size > max_size)
+        fb->buff_size = max_size;
+    if (fb->last_read > max_size)
+        fb->last_read = max_size;
+
+    if (at)
+    {
+        at->min = min_size;
+        at->max = at->cap = max_size;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_set_follow(fbuff * fb, int on, int timeout_ms)
+{
+    check(NULL == fb, FBUFF_BAD_ARG);
+    check(FBUFF_MODE_STDIO != fb->mode || fb->cache, FBUFF_BAD_ARG);
+
+#ifdef FBUFF_POSIX
+    fbuff_follow_free(fb->follow);
+    fb->follow = NULL;
+
+    if (!on)
+        return 0;
+
+    struct stat st;
+    if (fstat(fb->fd, &st) != 0)
         return FBUFF_FERR;
+
+    struct fbuff_follow * fl = calloc(1, sizeof(*fl));
+    if (NULL == fl)
+        return FBUFF_BAD_ALLOC;
+
+    fl->timeout = timeout_ms;
+    fl->linked = (st.st_nlink > 0);
+    fl->ino = -1;
+
+#ifdef FBUFF_INOTIFY
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fb->fd);
+    fl->ino = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fl->ino >= 0 && inotify_add_watch(fl->ino, path,
+        IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF) < 0)
+    {
+        close(fl->ino);
+        fl->ino = -1;
+    }
+#endif
+
+    fb->follow = fl;
+    return 0;
+#else
+    return on ? FBUFF_FERR : 0;
+#endif
+}
+//------------------------------------------------------------------------------
+
+int fbuff_cache_stats(fbuff * fb, fbuff_off * hits, fbuff_off * misses)
+{
+    check(NULL == fb || NULL == hits || NULL == misses, FBUFF_BAD_ARG);
+
+    *hits = *misses = 0;
+    if (fb->cache)
+    {
+        *hits = fb->cache->hits;
+        *misses = fb->cache->misses;
     }
+    return 0;
+}
+//------------------------------------------------------------------------------
 
+int fbuff_stats(fbuff * fb, fbuff_io_stats * out)
+{
+    check(NULL == fb || NULL == out, FBUFF_BAD_ARG);
+    *out = fb->stats;
     return 0;
 }
 //------------------------------------------------------------------------------
@@ -121,6 +2821,14 @@ int fbuff_fp(fbuff * fb, FILE ** out)
 }
 //------------------------------------------------------------------------------
 
+int fbuff_fd(fbuff * fb, int * out)
+{
+    check(NULL == fb || NULL == out, FBUFF_BAD_ARG);
+    *out = fb->fd;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
 int fbuff_state(fbuff * fb)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
@@ -128,14 +2836,14 @@ int fbuff_state(fbuff * fb)
 }
 //------------------------------------------------------------------------------
 
-int fbuff_buff_size(fbuff * fb)
+fbuff_off fbuff_buff_size(fbuff * fb)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
     return fb->buff_size;
 }
 //------------------------------------------------------------------------------
 
-long int fbuff_file_size(fbuff * fb)
+fbuff_off fbuff_file_size(fbuff * fb)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
     return fb->file_size;
@@ -150,14 +2858,14 @@ int fbuff_data(fbuff * fb, byte ** out)
 }
 //------------------------------------------------------------------------------
 
-int fbuff_last_read(fbuff * fb)
+fbuff_off fbuff_last_read(fbuff * fb)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
     return fb->last_read;
 }
 //------------------------------------------------------------------------------
 
-long int fbuff_all_read(fbuff * fb)
+fbuff_off fbuff_all_read(fbuff * fb)
 {
     check(NULL == fb, FBUFF_BAD_ARG);
     return fb->all_bytes_read;
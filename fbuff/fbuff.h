@@ -3,13 +3,18 @@
 
     Handles random access reading from an opened file.
 
-    fseek() with SEEK_END is used once in fbuff_init() in order to get the size
-    of the file. The size of the file is used to calculate the offset whenever
-    fbuff_set_offset() is called. If NO_SEEK_END is defined on compilation, the
-    file size is obtained by reading the file into the buffer in buffer size
-    chunks until EOF. The max size of the buffer is 2GB. All fbuff_ functions
-    perform argument checking and return FBUFF_BAD_ARG when an invalid value
-    is encountered. This is disabled if FBUFF_NO_CHECKS is defined on compile
+    The size of a regular file is taken with fstat() in fbuff_init(), or with
+    fseek() to SEEK_END once where there is no fstat(). The size of the file is
+    used to calculate the offset whenever fbuff_set_offset() is called. If
+    NO_SEEK_END is defined on compilation, the size of a file fstat() can't
+    give is obtained by reading the file into the buffer in buffer size chunks
+    until EOF. Pipes, sockets and other inputs which can't seek are read as
+    streams instead, whose size is not known until their end.
+
+    Offsets, sizes and byte counts are 64 bit fbuff_off values, so files and
+    buffers larger than 2GB are supported. All fbuff_ functions perform
+    argument checking and return FBUFF_BAD_ARG when an invalid value is
+    encountered. This is disabled if FBUFF_NO_CHECKS is defined on compile
     time.
 
     fbuff does not open or close files, it uses an already valid file pointer.
@@ -32,23 +37,90 @@ enum {
     FBUFF_BAD_ALLOC   = -2,
     FBUFF_EOF         = -3,
     FBUFF_FERR        = -4,
-    FBUFF_BAD_OFFSET  = -5
+    FBUFF_BAD_OFFSET  = -5,
+    FBUFF_NO_SIZE     = -6,
+    FBUFF_TRUNCATED   = -7,
+    FBUFF_ROTATED     = -8
 };
 /** Return codes. */
 
+struct fbuff_prefetch;
+struct fbuff_uring;
+struct fbuff_cache;
+struct fbuff_direct;
+struct fbuff_zip;
+struct fbuff_auto;
+struct fbuff_follow;
+struct fbuff_pool;
+
 typedef unsigned char byte;
+typedef long long int fbuff_off;
+/** 64 bit file offset and size type, independent of the off_t of the caller. */
+
+enum {
+    FBUFF_OP_READ,
+    FBUFF_OP_SEEK,
+    FBUFF_OP_READ_AT,
+    FBUFF_OP_IO,
+    FBUFF_OPS
+};
+/** Operations timed by fbuff_stats(). */
+
+#define FBUFF_STATS_BUCKETS 32
+
+typedef struct fbuff_op_stats {
+    fbuff_off count;
+    fbuff_off ns;
+    fbuff_off hist[FBUFF_STATS_BUCKETS];
+} fbuff_op_stats;
+/** count calls took ns nanoseconds in total. hist[i] counts the calls which
+took from 2^i up to 2^(i+1) nanoseconds, the last bucket also the longer
+ones. */
+
+typedef struct fbuff_io_stats {
+    fbuff_off requested;
+    fbuff_off delivered;
+    fbuff_off short_reads;
+    fbuff_op_stats ops[FBUFF_OPS];
+} fbuff_io_stats;
+/** Bytes asked for and read by fbuff_read() and fbuff_read_at(), the number
+of those reads which got less than asked, and the timings of each
+operation. */
+
 typedef struct fbuff {
     FILE * pfile;
-    long int file_size;
+    int fd;
+    fbuff_off file_size;
     int state;
     byte * data;
-    int buff_size;
-    int last_read;
-    long int all_bytes_read;
+    fbuff_off buff_size;
+    fbuff_off last_read;
+    fbuff_off all_bytes_read;
+    int mode;
+    byte * map;
+    fbuff_off pos;
+    fbuff_off data_off;
+    fbuff_off ahead;
+    struct fbuff_prefetch * pf;
+    struct fbuff_uring * ur;
+    struct fbuff_cache * cache;
+    struct fbuff_direct * dio;
+    struct fbuff_zip * zip;
+    int advice;
+    fbuff_off adv_done;
+    int pattern;
+    fbuff_off pat_off;
+    fbuff_off pat_len;
+    fbuff_off pat_stride;
+    struct fbuff_auto * tune;
+    struct fbuff_follow * follow;
+    struct fbuff_pool * pool;
+    fbuff_off pool_size;
+    fbuff_io_stats stats;
 } fbuff;
 /** Don't use members directly. */
 
-int fbuff_init(fbuff * pfb, FILE * fp, int buff_size);
+int fbuff_init(fbuff * pfb, FILE * fp, fbuff_off buff_size);
 /**
 Returns:
 Checks enabled
@@ -60,27 +132,160 @@ Always
     0 on success.
 
 Description: Initializes a fbuff with a size of buff_size bytes, ready to access
-the file pointed to by fp.
+the file pointed to by fp. When fp can't seek, like a pipe or a socket, the
+fbuff reads it as a stream from where it is: fbuff_file_size() gives
+FBUFF_NO_SIZE until the end is read, fbuff_set_offset() goes forward by
+reading and dropping the data, and back only within the data still in the
+buffer, and fbuff_read_at() is not available. When it fails, what it
+allocated is freed again.
+*/
+
+int fbuff_init_fd(fbuff * pfb, int fd, fbuff_off buff_size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pfb is NULL, fd is < 0, or buff_size is < 1.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    FBUFF_FERR if getting the file size fails, or on systems without read().
+    0 on success.
+
+Description: Like fbuff_init(), but reads the already open file descriptor fd
+with read() and lseek() instead of going through stdio, so the data is copied
+straight into the buffer. The file size comes from fstat(), and fd is read as
+a stream like in fbuff_init() when it can't seek. fbuff_fp() gives NULL for
+such a buffer. fbuff does not close fd.
+*/
+
+int fbuff_init_mmap(fbuff * pfb, FILE * fp, fbuff_off buff_size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pfb is NULL, fp is NULL, or buff_size is < 1.
+
+Always
+    FBUFF_FERR if fp is not a regular file or mapping it fails.
+    0 on success.
+
+Description: Like fbuff_init(), but maps the whole file read only instead of
+allocating a buffer. fbuff_read() does not copy anything, it only moves a
+window of at most buff_size bytes over the mapping, so the address returned by
+fbuff_data() changes after every read and set offset. The position of fp is
+not used or changed. Falls back to fbuff_init() on systems without mmap().
+*/
+
+int fbuff_init_prefetch(fbuff * pfb, FILE * fp, fbuff_off buff_size);
+/**
+Returns:
+Same values as fbuff_init().
+
+Description: Like fbuff_init(), but also starts a helper thread which reads the
+next buff_size bytes into a second buffer while the caller works on the
+current one. fbuff_read() with FBUFF_FILL then only waits for that read to
+finish and swaps the two buffers, so the address returned by fbuff_data()
+alternates between them. Reads of any other size, fbuff_set_offset() and
+fbuff_reset() discard the data read ahead. fp must not be used by the caller
+while the fbuff is alive. Falls back to fbuff_init() on systems without
+pthreads, when the thread can't be created, or when fp is read as a stream.
+*/
+
+int fbuff_init_uring(fbuff * pfb, FILE * fp, fbuff_off buff_size, int depth);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when depth is < 1.
+
+Always
+    Same values as fbuff_init().
+
+Description: Like fbuff_init(), but keeps up to depth reads of the following
+buff_size blocks of the file in flight with Linux io_uring. fbuff_read() with
+FBUFF_FILL hands the completed blocks over in file order and queues the next
+one. Reads of any other size and fbuff_set_offset() wait for the reads in
+flight and discard them. The file is read by offset, the position of fp is
+not used or changed. Falls back to fbuff_init() when io_uring is not available,
+buff_size is larger than a single read allows, or fp is read as a stream. The
+address returned by fbuff_data() changes after every read.
+*/
+
+int fbuff_init_direct(fbuff * pfb, FILE * fp, fbuff_off buff_size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pfb is NULL, fp is NULL, or buff_size is < 1.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    FBUFF_FERR if fp is not a regular file.
+    0 on success.
+
+Description: Like fbuff_init(), but reads bypass the page cache with O_DIRECT,
+for one pass scans of files which won't be read again. The file is reopened
+through /proc/self/fd with O_DIRECT, the buffer is block aligned, and reads
+are widened to whole blocks. The address returned by fbuff_data() points past
+the unaligned head of the block, so it can change after every read. The
+position of fp is not used or changed. Falls back to fbuff_init() when
+O_DIRECT is not available for the file.
+*/
+
+int fbuff_init_decomp(fbuff * pfb, FILE * fp, fbuff_off buff_size);
+/**
+Returns:
+Same values as fbuff_init(), and
+    FBUFF_FERR if the file is compressed in a format fbuff was built without,
+    or fp can't seek.
+
+Description: Like fbuff_init(), but when the file starts with the magic bytes
+of gzip, zstd or lz4 frame data, fbuff_read() decompresses it straight into
+the buffer, so the rest of the API sees the uncompressed data. Support for
+each format is compiled in with FBUFF_ZLIB, FBUFF_ZSTD and FBUFF_LZ4, linking
+zlib, libzstd and liblz4 respectively. Files in no known format are read as
+they are. fbuff_file_size() gives the content size from the zstd or lz4 frame
+header when the file is that one frame, and FBUFF_NO_SIZE otherwise until the
+end of the data is read. fbuff_set_offset() decompresses and drops the data up
+to offset, starting over from the beginning of the file when going back. Files
+in the seekable fbz format of fbz.h are read too, and for them
+fbuff_set_offset() costs nothing, since only the block which holds the next
+read is decompressed. The file is read by offset, the position of fp is not
+used or changed. fbuff_read_at() is not available for such a buffer.
+*/
+
+int fbuff_init_pool(fbuff * pfb, FILE * fp, fbuff_off buff_size,
+    struct fbuff_pool * pool);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when pfb, fp or pool is NULL, buff_size is < 1, or buff_size
+    is > FBPOOL_MAX_SIZE.
+
+Always
+    Same values as fbuff_pool_get() and fbuff_init().
+
+Description: Like fbuff_init(), but the buffer is borrowed from pool, see
+fbpool.h, instead of allocated, and fbuff_free() gives it back. When the pool
+is at its limit, this waits for a buffer like fbuff_pool_get() does.
 */
 
 #define FBUFF_FILL -1
-int fbuff_read(fbuff * fb, int nbytes);
+fbuff_off fbuff_read(fbuff * fb, fbuff_off nbytes);
 /**
 Returns:
 Checks enabled
     FBUFF_BAD_ARG when fb is NULL, nbytes is < 0 and different from FBUFF_FILL,
-    or when nbytes is > buff_size.
+    or when nbytes is > buff_size, or the max_size of fbuff_set_auto().
 
 Always
     FBUFF_ERR if ferror() returns true.
     FBUFF_EOF if feof() returns true.
+    FBUFF_TRUNCATED and FBUFF_ROTATED as described in fbuff_set_follow().
     The number of bytes read otherwise.
 
 Description: Reads nbytes number of bytes inside the buffer. If nbytes is set to
 FBUFF_FILL, then the function attempts to read buff_size bytes.
 */
 
-int fbuff_set_offset(fbuff * fb, long int offset);
+int fbuff_set_offset(fbuff * fb, fbuff_off offset);
 /**
 Returns:
 Checks enabled
@@ -92,7 +297,239 @@ Always
     0 on success.
 
 Description: Changes the offset in the file. offset can be negative, in which
-case the file position is set to -(offset) bytes before eof.
+case the file position is set to -(offset) bytes before eof. While the file
+size is not known, negative offsets are out of bounds, and going past the end
+leaves the buffer at eof. On a stream, offsets before the data in the buffer
+are out of bounds.
+*/
+
+enum {
+    FBUFF_ADV_NORMAL,
+    FBUFF_ADV_SEQUENTIAL,
+    FBUFF_ADV_RANDOM,
+    FBUFF_ADV_WILLNEED,
+    FBUFF_ADV_DONTNEED
+};
+/** Access pattern hints. */
+
+int fbuff_advise(fbuff * fb, int advice, fbuff_off offset, fbuff_off len);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb is NULL, advice is not one of the FBUFF_ADV_ values,
+    or len is < 0.
+
+Always
+    FBUFF_BAD_OFFSET when offset points outside the bounds of the file.
+    0 on success.
+
+Description: Tells the kernel how len bytes from offset are going to be read,
+with posix_fadvise(), or madvise() for fbuff_init_mmap() buffers. A len of 0
+means to the end of the file. offset can be negative like in
+fbuff_set_offset(). FBUFF_ADV_NORMAL, FBUFF_ADV_SEQUENTIAL and
+FBUFF_ADV_RANDOM also become the access pattern of the buffer. While it is
+FBUFF_ADV_SEQUENTIAL, every fbuff_read() drops the pages before the buffer
+from the page cache and asks for the next buff_size bytes to be read ahead.
+The hints are only advice and do nothing on systems without them.
+*/
+
+enum {
+    FBUFF_PAT_NONE,
+    FBUFF_PAT_SEQUENTIAL,
+    FBUFF_PAT_STRIDED,
+    FBUFF_PAT_REVERSE
+};
+/** Access patterns. */
+
+#define FBUFF_PREDICT_DEPTH 4
+
+int fbuff_pattern(fbuff * fb);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb is NULL.
+
+Always
+    The access pattern of the last fbuff_read() calls.
+
+Description: Every fbuff_read() compares where it starts in the file with
+where the one before it started. A read which starts where the previous one
+ended makes the pattern FBUFF_PAT_SEQUENTIAL. The same distance between the
+starts of three reads in a row makes it FBUFF_PAT_STRIDED going forward, and
+FBUFF_PAT_REVERSE going back. While it is strided or reverse, the regions the
+next FBUFF_PREDICT_DEPTH reads would get with the same distance and size are
+asked to be read ahead, as if by fbuff_advise() with FBUFF_ADV_WILLNEED, so
+they are in memory by the time the caller gets there. Sequential reads are
+left to the read ahead of the system. Nothing is read ahead for
+fbuff_init_direct() and fbuff_init_decomp() buffers. fbuff_advise() with
+FBUFF_ADV_RANDOM turns the detection off until another pattern is advised,
+and the pattern stays FBUFF_PAT_NONE.
+*/
+
+fbuff_off fbuff_get_offset(fbuff * fb);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb is NULL.
+
+Always
+    The offset in the file the next read starts from.
+
+Description: Returns the offset the buffer has reached in the file.
+*/
+
+fbuff_off fbuff_get(fbuff * fb, fbuff_off offset, fbuff_off len, byte ** ptr);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb or ptr is NULL, len is < 0, or len is > buff_size.
+
+Always
+    FBUFF_BAD_OFFSET when offset points outside the bounds of the file.
+    FBUFF_FERR if seeking or reading fails.
+    The number of bytes available at ptr otherwise, less than len only at eof.
+
+Description: Sets ptr pointing to the data at offset in the file. The buffer
+remembers which part of the file it holds after each read, so when the range
+from offset to offset + len is already there, no I/O is done and nothing
+changes. Otherwise the buffer is refilled with a window which starts a quarter
+of the buffer before offset, as if by fbuff_set_offset() and fbuff_read() with
+FBUFF_FILL, except that the jump doesn't halve the buffer of fbuff_set_auto().
+offset can be negative like in fbuff_set_offset(). ptr is valid until the next
+read.
+*/
+
+fbuff_off fbuff_read_at(fbuff * fb, fbuff_off offset, fbuff_off nbytes,
+    byte * dst);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb or dst is NULL, or nbytes is < 0.
+
+Always
+    FBUFF_BAD_ARG when fb decompresses its file or reads a stream.
+    FBUFF_BAD_OFFSET when offset points outside the bounds of the file.
+    FBUFF_FERR if reading fails.
+    The number of bytes read otherwise, less than nbytes only at eof.
+
+Description: Reads nbytes bytes starting at offset into dst, which must be
+large enough to hold them. offset can be negative like in fbuff_set_offset().
+The buffer, its state, the read counters and the file position are not used or
+changed, so any number of threads can call it on the same fbuff at the same
+time, each with its own dst. Uses pread(), or memcpy() from the mapping of an
+fbuff_init_mmap() buffer. On systems without pread() it falls back to seeking
+the file and back, which is not thread safe.
+*/
+
+int fbuff_set_cache(fbuff * fb, fbuff_off block_size, fbuff_off budget);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb is NULL, block_size is < 1, budget is < 0 or less
+    than block_size but not 0, fb was not initialized with fbuff_init(), reads
+    a stream, or follows its file.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    Same values as fbuff_set_offset() when the cache is turned off.
+    0 on success.
+
+Description: Turns on a cache of budget bytes worth of block_size aligned
+blocks of the file, evicted in CLOCK order. fbuff_read() then copies the data
+from the cached blocks, reading only the missing ones with fbuff_read_at(), so
+going back to recently read regions after fbuff_set_offset() costs no I/O. The
+file position is not used while the cache is on. A budget of 0 turns the cache
+off and moves the file position to where the buffer left off. Calling it again
+drops the cached blocks and the counters.
+*/
+
+#define FBUFF_FOLLOW_POLL_MS 10
+int fbuff_set_follow(fbuff * fb, int on, int timeout_ms);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb is NULL, or fb was not initialized with fbuff_init()
+    or fbuff_init_fd(), reads a stream, or has a cache.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    FBUFF_FERR if getting the file status fails, or on systems without
+    fstat().
+    0 on success.
+
+Description: Turns on following a file which is still being written, when on
+is not 0, or turns it off. While following, an fbuff_read() which finds no
+data at eof checks the file size with fstat() and waits up to timeout_ms
+milliseconds for more, forever if timeout_ms is < 0. Only when none comes
+does it return 0 and leave the state FBUFF_EOF, else the state stays 0, and
+the file size grows with the data. On Linux the wait is for inotify events of
+the file, elsewhere the size is checked every FBUFF_FOLLOW_POLL_MS
+milliseconds. When the file has shrunk below the offset of the buffer,
+fbuff_read() returns FBUFF_TRUNCATED and the file size is the new one, so
+reading can go on after fbuff_set_offset(). When the file was deleted, or
+on Linux renamed, and all of its data has been read, fbuff_read() returns
+FBUFF_ROTATED from then on, and the file has to be opened again by name to go
+on.
+*/
+
+int fbuff_cache_stats(fbuff * fb, fbuff_off * hits, fbuff_off * misses);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb, hits or misses is NULL.
+
+Always
+    0 on success.
+
+Description: Sets hits and misses to the number of block lookups served from
+the cache and read from the file. Both are 0 when the cache is off.
+*/
+
+int fbuff_set_auto(fbuff * fb, fbuff_off min_size, fbuff_off max_size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb is NULL, min_size is < 1, max_size is < min_size, fb
+    was not initialized with fbuff_init(), fbuff_init_fd() or
+    fbuff_init_pool(), or its pooled buffer holds less than max_size bytes.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    0 on success.
+
+Description: Lets the buffer size move between min_size and max_size with the
+way the file is read. The buffer is reallocated to max_size bytes, and the
+buffer size is brought within the bounds. A buffer from a pool is not
+reallocated, the whole of its size class is used. After every two fbuff_read()
+calls with FBUFF_FILL which get a full buffer, the buffer size doubles, as long
+as the bigger reads move the bytes no slower than the smaller ones did. A
+fbuff_set_offset() to somewhere else after no more than one buffer of data was
+read since the last one halves it. fbuff_buff_size() gives the current size,
+which is what FBUFF_FILL reads, but fbuff_read() takes up to max_size bytes. A
+min_size equal to max_size turns the resizing off and leaves the buffer at that
+size. The address returned by fbuff_data() changes when this is called.
+*/
+
+int fbuff_stats(fbuff * fb, fbuff_io_stats * out);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb or out is NULL.
+
+Always
+    0 on success.
+
+Description: Copies the statistics the buffer has gathered into out. The I/O
+done by the fbuff_init_ functions is counted too. ops[FBUFF_OP_READ].count is
+the number of fbuff_read() calls, ops[FBUFF_OP_SEEK].count the number of
+fbuff_set_offset() calls and of the seeks made by fbuff_get() and
+fbuff_reset(), and ops[FBUFF_OP_READ_AT] is for fbuff_read_at().
+ops[FBUFF_OP_IO] times every wait for the file inside the other operations, so
+its ns is the time spent blocked in I/O: the reads, seeks, waits for prefetched
+or queued data, and reads of compressed data or cache blocks. Page faults of
+fbuff_init_mmap() buffers can't be seen. Timing takes two clock reads per call.
+Everything is left out and out is zeroed if FBUFF_NO_STATS is defined on
+compilation.
 */
 
 int fbuff_reset(fbuff * fb);
@@ -105,7 +542,8 @@ Always
     Same values as fbuff_set_offset().
 
 Description: Zeroes out the buffer state, last read, all read information, and
-rewinds the file back to its start.
+rewinds the file back to its start. A stream can only be rewound while its start
+is still in the buffer.
 */
 
 int fbuff_free(fbuff * fb);
@@ -137,6 +575,20 @@ Description: Sets the value of out to the value of the FILE * associated with
 the buffer.
 */
 
+int fbuff_fd(fbuff * fb, int * out);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fb or out is NULL.
+
+Always
+    0 on success.
+
+Description: Sets the value of out to the file descriptor the buffer reads
+from, which is the one of its FILE * when it has one. It is -1 on systems
+without file descriptors.
+*/
+
 int fbuff_state(fbuff * fb);
 /**
 Returns:
@@ -151,7 +603,7 @@ Always
 Description: Returns the state of the buffer. 0 is the default.
 */
 
-int fbuff_buff_size(fbuff * fb);
+fbuff_off fbuff_buff_size(fbuff * fb);
 /**
 Returns:
 Checks enabled
@@ -163,7 +615,7 @@ Always
 Description: Returns the buffer size.
 */
 
-long int fbuff_file_size(fbuff * fb);
+fbuff_off fbuff_file_size(fbuff * fb);
 /**
 Returns:
 Checks enabled
@@ -171,6 +623,8 @@ Checks enabled
 
 Always
     The file size on success.
+    FBUFF_NO_SIZE when the uncompressed size of the file, or the size of a
+    stream, is not known yet.
 
 Description: Returns the file size of the file associated with the buffer.
 */
@@ -185,10 +639,13 @@ Always
     0 on success.
 
 Description: Sets out pointing to the buffer containing the data read from the
-file. This address does not change during the life of a fbuff.
+file. This address does not change during the life of a fbuff, unless it was
+initialized with fbuff_init_mmap(), fbuff_init_prefetch(), fbuff_init_uring()
+or fbuff_init_direct(). Call it again after each read in that case, and after
+fbuff_set_auto().
 */
 
-int fbuff_last_read(fbuff * fb);
+fbuff_off fbuff_last_read(fbuff * fb);
 /**
 Returns:
 Checks enabled
@@ -200,7 +657,7 @@ Always
 Description: Returns the result of the last read.
 */
 
-long int fbuff_all_read(fbuff * fb);
+fbuff_off fbuff_all_read(fbuff * fb);
 /**
 Returns:
 Checks enabled
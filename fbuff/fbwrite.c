@@ -0,0 +1,303 @@
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define FBWRITE_POSIX
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "fbwrite.h"
+
+#ifdef FBWRITE_POSIX
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef FBUFF_NO_CHECKS
+#define check(expr, val)
+#else
+#define check(expr, val) while (expr) return (val)
+#endif
+//------------------------------------------------------------------------------
+
+#ifdef FBWRITE_POSIX
+static int fbwrite_fd(int fd, const byte * a, fbuff_off alen, const byte * b,
+    fbuff_off blen)
+{
+    struct iovec iov[2];
+    int i = 0;
+
+    iov[0].iov_base = (void *)a;
+    iov[0].iov_len = (size_t)alen;
+    iov[1].iov_base = (void *)b;
+    iov[1].iov_len = (size_t)blen;
+
+    while (i < 2)
+    {
+        if (0 == iov[i].iov_len)
+        {
+            ++i;
+            continue;
+        }
+
+        ssize_t written = writev(fd, iov + i, 2 - i);
+        if (written < 0 && EINTR == errno)
+            continue;
+        if (written <= 0)
+            return FBUFF_FERR;
+
+        for (; i < 2 && (size_t)written >= iov[i].iov_len; ++i)
+            written -= iov[i].iov_len;
+        if (i < 2)
+        {
+            iov[i].iov_base = (byte *)iov[i].iov_base + written;
+            iov[i].iov_len -= written;
+        }
+    }
+    return 0;
+}
+/** Writes a and then b, going on after short writes. */
+#endif
+//------------------------------------------------------------------------------
+
+static int fbwrite_sync(fbuff_writer * fw)
+{
+    if (fw->pfile && fflush(fw->pfile) != 0)
+        return FBUFF_FERR;
+
+#ifdef FBWRITE_POSIX
+    int fd = fw->pfile ? fileno(fw->pfile) : fw->fd;
+    int err;
+#if defined(__linux__)
+    if (fw->sync & FBWRITE_SYNC_DATA)
+        err = fdatasync(fd);
+    else
+#endif
+    err = fsync(fd);
+
+    if (err != 0)
+        return FBUFF_FERR;
+#endif
+
+    fw->unsynced = 0;
+    return 0;
+}
+/** fdatasync() is used only where it is known to exist, elsewhere fsync()
+does the same and more. */
+//------------------------------------------------------------------------------
+
+static int fbwrite_out(fbuff_writer * fw, const byte * src, fbuff_off nbytes)
+{
+    int err = 0;
+
+    if (FBUFF_FERR == fw->state)
+        return FBUFF_FERR;
+
+#ifdef FBWRITE_POSIX
+    if (NULL == fw->pfile)
+        err = fbwrite_fd(fw->fd, fw->data, fw->used, src, nbytes);
+    else
+#endif
+    if (fwrite(fw->data, 1, (size_t)fw->used, fw->pfile) != (size_t)fw->used ||
+        (nbytes > 0 &&
+        fwrite(src, 1, (size_t)nbytes, fw->pfile) != (size_t)nbytes))
+        err = FBUFF_FERR;
+
+    if (0 == err)
+    {
+        fw->unsynced += fw->used + nbytes;
+        fw->used = 0;
+
+        if (FBWRITE_SYNC_BYTES == (fw->sync & ~FBWRITE_SYNC_DATA) &&
+            fw->unsynced >= fw->sync_every)
+            err = fbwrite_sync(fw);
+    }
+
+    if (err != 0)
+        fw->state = FBUFF_FERR;
+    return err;
+}
+/** Writes the buffered data followed by nbytes from src, and syncs when the
+policy asks for it. */
+//------------------------------------------------------------------------------
+
+static int fbwrite_init(fbuff_writer * fw, FILE * fp, int fd,
+    fbuff_off buff_size)
+{
+    memset(fw, 0, sizeof(*fw));
+    fw->pfile = fp;
+    fw->fd = fd;
+    fw->sync = FBWRITE_SYNC_NEVER;
+
+    if ((uint64_t)buff_size > SIZE_MAX ||
+        NULL == (fw->data = malloc((size_t)buff_size)))
+        return FBUFF_BAD_ALLOC;
+    fw->buff_size = buff_size;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_init(fbuff_writer * fw, FILE * fp, fbuff_off buff_size)
+{
+    check(NULL == fw || NULL == fp || buff_size < 1, FBUFF_BAD_ARG);
+#ifdef FBWRITE_POSIX
+    return fbwrite_init(fw, fp, fileno(fp), buff_size);
+#else
+    return fbwrite_init(fw, fp, -1, buff_size);
+#endif
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_init_fd(fbuff_writer * fw, int fd, fbuff_off buff_size)
+{
+#ifdef FBWRITE_POSIX
+    check(NULL == fw || fd < 0 || buff_size < 1, FBUFF_BAD_ARG);
+    return fbwrite_init(fw, NULL, fd, buff_size);
+#else
+    return FBUFF_FERR;
+#endif
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_set_sync(fbuff_writer * fw, int policy, fbuff_off every)
+{
+    int when = policy & ~FBWRITE_SYNC_DATA;
+
+    check(NULL == fw || when < FBWRITE_SYNC_NEVER || when > FBWRITE_SYNC_CLOSE,
+        FBUFF_BAD_ARG);
+    check(FBWRITE_SYNC_BYTES == when && every < 1, FBUFF_BAD_ARG);
+    (void)when;
+
+    fw->reserved = 0;
+    fw->sync = policy;
+    fw->sync_every = every;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+fbuff_off fbuff_writer_append(fbuff_writer * fw, const byte * src,
+    fbuff_off nbytes)
+{
+    check(NULL == fw || nbytes < 0 || (NULL == src && nbytes > 0),
+        FBUFF_BAD_ARG);
+
+    fw->reserved = 0;
+    if (FBUFF_FERR == fw->state)
+        return FBUFF_FERR;
+
+    fbuff_off room = fw->buff_size - fw->used;
+    if (nbytes <= room)
+    {
+        if (nbytes > 0)
+            memcpy(fw->data + fw->used, src, (size_t)nbytes);
+        fw->used += nbytes;
+    }
+    else if (nbytes < fw->buff_size)
+    {
+        memcpy(fw->data + fw->used, src, (size_t)room);
+        fw->used = fw->buff_size;
+        if (fbwrite_out(fw, NULL, 0) != 0)
+            return FBUFF_FERR;
+
+        memcpy(fw->data, src + room, (size_t)(nbytes - room));
+        fw->used = nbytes - room;
+    }
+    else if (fbwrite_out(fw, src, nbytes) != 0)
+        return FBUFF_FERR;
+
+    fw->all_bytes_written += nbytes;
+    return nbytes;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_reserve(fbuff_writer * fw, fbuff_off nbytes, byte ** ptr)
+{
+    check(NULL == fw || NULL == ptr || nbytes < 1 || nbytes > fw->buff_size,
+        FBUFF_BAD_ARG);
+
+    fw->reserved = 0;
+    if (FBUFF_FERR == fw->state)
+        return FBUFF_FERR;
+
+    if (nbytes > fw->buff_size - fw->used && fbwrite_out(fw, NULL, 0) != 0)
+        return FBUFF_FERR;
+
+    fw->reserved = nbytes;
+    *ptr = fw->data + fw->used;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_commit(fbuff_writer * fw, fbuff_off nbytes)
+{
+    check(NULL == fw || nbytes < 0 || nbytes > fw->reserved, FBUFF_BAD_ARG);
+
+    fw->used += nbytes;
+    fw->all_bytes_written += nbytes;
+    fw->reserved = 0;
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_flush(fbuff_writer * fw)
+{
+    check(NULL == fw, FBUFF_BAD_ARG);
+
+    fw->reserved = 0;
+    if (fbwrite_out(fw, NULL, 0) != 0)
+        return FBUFF_FERR;
+
+    if (fw->pfile && fflush(fw->pfile) != 0)
+    {
+        fw->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_sync(fbuff_writer * fw)
+{
+    check(NULL == fw, FBUFF_BAD_ARG);
+
+    fw->reserved = 0;
+    if (fbwrite_out(fw, NULL, 0) != 0)
+        return FBUFF_FERR;
+
+    if (fbwrite_sync(fw) != 0)
+    {
+        fw->state = FBUFF_FERR;
+        return FBUFF_FERR;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_state(fbuff_writer * fw)
+{
+    check(NULL == fw, FBUFF_BAD_ARG);
+    return fw->state;
+}
+//------------------------------------------------------------------------------
+
+fbuff_off fbuff_writer_all_written(fbuff_writer * fw)
+{
+    check(NULL == fw, FBUFF_BAD_ARG);
+    return fw->all_bytes_written;
+}
+//------------------------------------------------------------------------------
+
+int fbuff_writer_free(fbuff_writer * fw)
+{
+    check(NULL == fw, FBUFF_BAD_ARG);
+
+    int err = (FBWRITE_SYNC_NEVER == (fw->sync & ~FBWRITE_SYNC_DATA)) ?
+        fbuff_writer_flush(fw) : fbuff_writer_sync(fw);
+
+    free(fw->data);
+    memset(fw, 0, sizeof(*fw));
+    return err;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,212 @@
+/**
+    A file write buffer
+
+    The write side counterpart of fbuff. Appended data is gathered in a buffer
+    of buff_size bytes, which goes to the file in one write when it fills up,
+    so many small appends cost a single system call. Appends of a buffer or
+    more skip the copy and go out together with what is already buffered in a
+    single writev(). Data can also be produced straight into the buffer with
+    fbuff_writer_reserve() and fbuff_writer_commit(). How often the written
+    data is forced to disk is set with fbuff_writer_set_sync().
+
+    Like fbuff, fbuff_writer does not open or close files, it uses an already
+    valid file pointer or descriptor. All functions perform argument checking
+    and return FBUFF_BAD_ARG when an invalid value is encountered, unless
+    FBUFF_NO_CHECKS is defined on compile time.
+*/
+
+#ifndef FBWRITE_H
+#define FBWRITE_H
+
+#include "fbuff.h"
+
+enum {
+    FBWRITE_SYNC_NEVER,
+    FBWRITE_SYNC_BYTES,
+    FBWRITE_SYNC_CLOSE,
+    FBWRITE_SYNC_DATA = 0x10
+};
+/** Sync policies. FBWRITE_SYNC_DATA can be or-ed to the others. */
+
+typedef struct fbuff_writer {
+    FILE * pfile;
+    int fd;
+    int state;
+    byte * data;
+    fbuff_off buff_size;
+    fbuff_off used;
+    fbuff_off reserved;
+    fbuff_off all_bytes_written;
+    int sync;
+    fbuff_off sync_every;
+    fbuff_off unsynced;
+} fbuff_writer;
+/** Don't use members directly. */
+
+int fbuff_writer_init(fbuff_writer * fw, FILE * fp, fbuff_off buff_size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL, fp is NULL, or buff_size is < 1.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    0 on success.
+
+Description: Initializes a writer with a buffer of buff_size bytes, which
+writes to the file pointed to by fp at its current position with fwrite().
+The sync policy is FBWRITE_SYNC_NEVER.
+*/
+
+int fbuff_writer_init_fd(fbuff_writer * fw, int fd, fbuff_off buff_size);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL, fd is < 0, or buff_size is < 1.
+
+Always
+    FBUFF_BAD_ALLOC if memory allocation fails.
+    FBUFF_FERR on systems without write().
+    0 on success.
+
+Description: Like fbuff_writer_init(), but writes to the already open file
+descriptor fd with write() and writev().
+*/
+
+int fbuff_writer_set_sync(fbuff_writer * fw, int policy, fbuff_off every);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL, policy is not one of the FBWRITE_SYNC_
+    values, or policy is FBWRITE_SYNC_BYTES and every is < 1.
+
+Always
+    0 on success.
+
+Description: Sets when the written data is forced to disk with fsync(), or
+with fdatasync() if FBWRITE_SYNC_DATA is or-ed to policy. With
+FBWRITE_SYNC_NEVER it is left to the system, with FBWRITE_SYNC_CLOSE it is
+done by fbuff_writer_free(), and with FBWRITE_SYNC_BYTES also after every
+write which brings the bytes written since the last sync to every or more.
+On systems without fsync() only the FILE * is flushed.
+*/
+
+fbuff_off fbuff_writer_append(fbuff_writer * fw, const byte * src,
+    fbuff_off nbytes);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL, nbytes is < 0, or src is NULL and nbytes is
+    > 0.
+
+Always
+    FBUFF_FERR if writing or syncing fails, now or before.
+    nbytes on success.
+
+Description: Appends nbytes bytes from src. They are copied into the buffer,
+which is written out whenever it fills up. When nbytes is at least buff_size,
+the buffered data and src are written with a single call instead, without
+copying src.
+*/
+
+int fbuff_writer_reserve(fbuff_writer * fw, fbuff_off nbytes, byte ** ptr);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw or ptr is NULL, nbytes is < 1, or nbytes is >
+    buff_size.
+
+Always
+    FBUFF_FERR if writing or syncing fails, now or before.
+    0 on success.
+
+Description: Sets ptr pointing to nbytes free bytes at the end of the
+buffered data, writing the buffer out first if there is not enough room.
+Fill them in place and call fbuff_writer_commit() to append them. The
+reservation is dropped by any other call on fw.
+*/
+
+int fbuff_writer_commit(fbuff_writer * fw, fbuff_off nbytes);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL, nbytes is < 0, or nbytes is more than the
+    last fbuff_writer_reserve() gave.
+
+Always
+    0 on success.
+
+Description: Appends the first nbytes of the reserved bytes. The rest of them
+are given back.
+*/
+
+int fbuff_writer_flush(fbuff_writer * fw);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL.
+
+Always
+    FBUFF_FERR if writing or syncing fails, now or before.
+    0 on success.
+
+Description: Writes out the buffered data, and flushes the FILE * of the
+writer if it has one. Syncs only as the policy says.
+*/
+
+int fbuff_writer_sync(fbuff_writer * fw);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL.
+
+Always
+    FBUFF_FERR if writing or syncing fails, now or before.
+    0 on success.
+
+Description: Writes out the buffered data and forces it to disk, whatever the
+policy.
+*/
+
+int fbuff_writer_state(fbuff_writer * fw);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL.
+
+Always
+    FBUFF_FERR if an error has occurred.
+    0 otherwise.
+
+Description: Returns the state of the writer. Once writing fails, every
+following call which writes fails too.
+*/
+
+fbuff_off fbuff_writer_all_written(fbuff_writer * fw);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL.
+
+Always
+    The number of bytes appended so far.
+
+Description: Counts the buffered bytes too, so it is where the next append
+lands, relative to where the writer started.
+*/
+
+int fbuff_writer_free(fbuff_writer * fw);
+/**
+Returns:
+Checks enabled
+    FBUFF_BAD_ARG when fw is NULL.
+
+Always
+    FBUFF_FERR if writing or syncing the remaining data fails, now or before.
+    0 on success.
+
+Description: Writes out the buffered data, syncs it unless the policy is
+FBWRITE_SYNC_NEVER, frees the buffer and zeroes out all writer data members.
+The memory is freed even when writing fails.
+*/
+#endif
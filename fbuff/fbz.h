@@ -0,0 +1,37 @@
+/**
+    A seekable block compressed file format
+
+    The data is cut into blocks of block_size bytes, the last of which can be
+    shorter, and every block is compressed on its own. An index of where the
+    blocks start follows them, so reading from any offset takes decompressing
+    only the block which holds it. fbuff_init_decomp() reads fbz files, the
+    fbzpack tool makes them from plain files. All numbers are unsigned 64 bit
+    little endian.
+
+        header    FBZ_MAGIC, then the codec in one byte and three zero bytes
+        blocks    the compressed blocks one after the other
+        index     nblocks + 1 offsets in the file, of each block and lastly
+                  of the index itself
+        trailer   block_size, data_size, nblocks, the offset of the index,
+                  then FBZ_MAGIC again
+
+    data_size is the size of the uncompressed data. A block is a zlib stream,
+    or a zstd frame.
+*/
+
+#ifndef FBZ_H
+#define FBZ_H
+
+#define FBZ_MAGIC           "FBZ1"
+#define FBZ_MAGIC_LEN       4
+#define FBZ_HEADER_SIZE     8
+#define FBZ_TRAILER_SIZE    (4 * 8 + FBZ_MAGIC_LEN)
+#define FBZ_BLOCK_SIZE      (256 * 1024)
+
+enum {
+    FBZ_ZLIB = 1,
+    FBZ_ZSTD = 2
+};
+/** Codecs. */
+
+#endif
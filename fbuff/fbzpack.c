@@ -0,0 +1,219 @@
+/**
+    fbzpack - converts a plain file into the fbz format described in fbz.h
+
+    fbzpack [-b <block size>] [-c zlib|zstd] [-l <level>] <in> <out>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fbuff.h"
+#include "fbz.h"
+
+#ifdef FBUFF_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FBUFF_ZSTD
+#include <zstd.h>
+#endif
+
+static const char prog[] = "fbzpack";
+//------------------------------------------------------------------------------
+
+static int usage(void)
+{
+    fprintf(stderr,
+        "Use: %s [-b <block size>] [-c zlib|zstd] [-l <level>] <in> <out>\n",
+        prog);
+    return EXIT_FAILURE;
+}
+//------------------------------------------------------------------------------
+
+static int fail(const char * what, const char * name)
+{
+    fprintf(stderr, "%s: error: %s < %s >\n", prog, what, name);
+    return EXIT_FAILURE;
+}
+//------------------------------------------------------------------------------
+
+static void put_u64(byte * dst, uint64_t val)
+{
+    int i;
+    for (i = 0; i < 8; ++i, val >>= 8)
+        dst[i] = (byte)(val & 0xFF);
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off pack_bound(int codec, fbuff_off len)
+{
+#ifdef FBUFF_ZLIB
+    if (FBZ_ZLIB == codec)
+        return (fbuff_off)compressBound((uLong)len);
+#endif
+#ifdef FBUFF_ZSTD
+    if (FBZ_ZSTD == codec)
+        return (fbuff_off)ZSTD_compressBound((size_t)len);
+#endif
+    return -1;
+}
+//------------------------------------------------------------------------------
+
+static fbuff_off pack_block(int codec, int level, byte * dst, fbuff_off cap,
+    const byte * src, fbuff_off len)
+{
+#ifdef FBUFF_ZLIB
+    if (FBZ_ZLIB == codec)
+    {
+        uLongf out_len = (uLongf)cap;
+        if (compress2(dst, &out_len, src, (uLong)len,
+            (level < 0) ? Z_DEFAULT_COMPRESSION : level) != Z_OK)
+            return -1;
+        return (fbuff_off)out_len;
+    }
+#endif
+#ifdef FBUFF_ZSTD
+    if (FBZ_ZSTD == codec)
+    {
+        size_t out_len = ZSTD_compress(dst, (size_t)cap, src, (size_t)len,
+            (level < 0) ? ZSTD_CLEVEL_DEFAULT : level);
+        return ZSTD_isError(out_len) ? -1 : (fbuff_off)out_len;
+    }
+#endif
+    return -1;
+}
+/** Returns the compressed size, -1 on error. */
+//------------------------------------------------------------------------------
+
+static int pack(fbuff * fb, FILE * out, int codec, int level)
+{
+    byte head[FBZ_HEADER_SIZE] = {0};
+    byte tail[FBZ_TRAILER_SIZE];
+    byte num[8];
+    fbuff_off block_size = fbuff_buff_size(fb);
+    fbuff_off cap = pack_bound(codec, block_size);
+    fbuff_off offset = FBZ_HEADER_SIZE;
+    fbuff_off n = 0, i, len;
+    fbuff_off index_cap = 64;
+    byte * data = NULL;
+
+    byte * dst = (cap > 0) ? malloc((size_t)cap) : NULL;
+    fbuff_off * index = malloc((size_t)index_cap * sizeof(*index));
+    if (NULL == dst || NULL == index)
+        goto fail;
+
+    memcpy(head, FBZ_MAGIC, FBZ_MAGIC_LEN);
+    head[FBZ_MAGIC_LEN] = (byte)codec;
+    if (fwrite(head, 1, sizeof(head), out) != sizeof(head))
+        goto fail;
+
+    while ((len = fbuff_read(fb, FBUFF_FILL)) > 0)
+    {
+        fbuff_off packed;
+
+        if (n + 1 == index_cap)
+        {
+            fbuff_off * more = realloc(index,
+                (size_t)(2 * index_cap) * sizeof(*index));
+            if (NULL == more)
+                goto fail;
+            index = more;
+            index_cap *= 2;
+        }
+
+        fbuff_data(fb, &data);
+        if ((packed = pack_block(codec, level, dst, cap, data, len)) < 0 ||
+            fwrite(dst, 1, (size_t)packed, out) != (size_t)packed)
+            goto fail;
+
+        index[n++] = offset;
+        offset += packed;
+    }
+    if (fbuff_state(fb) == FBUFF_FERR)
+        goto fail;
+    index[n] = offset;
+
+    for (i = 0; i <= n; ++i)
+    {
+        put_u64(num, (uint64_t)index[i]);
+        if (fwrite(num, 1, sizeof(num), out) != sizeof(num))
+            goto fail;
+    }
+
+    put_u64(tail, (uint64_t)block_size);
+    put_u64(tail + 8, (uint64_t)fbuff_all_read(fb));
+    put_u64(tail + 16, (uint64_t)n);
+    put_u64(tail + 24, (uint64_t)offset);
+    memcpy(tail + 32, FBZ_MAGIC, FBZ_MAGIC_LEN);
+    if (fwrite(tail, 1, sizeof(tail), out) != sizeof(tail))
+        goto fail;
+
+    free(index);
+    free(dst);
+    return 0;
+
+fail:
+    free(index);
+    free(dst);
+    return -1;
+}
+/** Packs the blocks until eof, so the size of the input needn't be known and
+pipes are packed too. The index is grown as blocks are written. */
+//------------------------------------------------------------------------------
+
+int main(int argc, char * argv[])
+{
+    fbuff_off block_size = FBZ_BLOCK_SIZE;
+    int level = -1;
+    int i;
+#ifdef FBUFF_ZLIB
+    int codec = FBZ_ZLIB;
+#else
+    int codec = FBZ_ZSTD;
+#endif
+
+    for (i = 1; i < argc - 2; i += 2)
+    {
+        if (0 == strcmp(argv[i], "-b"))
+            block_size = strtoll(argv[i+1], NULL, 10);
+        else if (0 == strcmp(argv[i], "-l"))
+            level = atoi(argv[i+1]);
+        else if (0 == strcmp(argv[i], "-c") && 0 == strcmp(argv[i+1], "zlib"))
+            codec = FBZ_ZLIB;
+        else if (0 == strcmp(argv[i], "-c") && 0 == strcmp(argv[i+1], "zstd"))
+            codec = FBZ_ZSTD;
+        else
+            return usage();
+    }
+
+    if (i != argc - 2 || block_size < 1)
+        return usage();
+
+    if (pack_bound(codec, block_size) < 0)
+        return fail("codec is not compiled in",
+            (FBZ_ZLIB == codec) ? "zlib" : "zstd");
+
+    const char * in_name = argv[i];
+    const char * out_name = argv[i+1];
+
+    FILE * in = fopen(in_name, "rb");
+    if (NULL == in)
+        return fail("couldn't open file", in_name);
+
+    fbuff fb;
+    if (fbuff_init(&fb, in, block_size) != 0)
+    {
+        fclose(in);
+        return fail("couldn't read file", in_name);
+    }
+
+    FILE * out = fopen(out_name, "wb");
+    int err = (NULL == out || pack(&fb, out, codec, level) != 0);
+
+    if (out && fclose(out) != 0)
+        err = 1;
+    fbuff_free(&fb);
+    fclose(in);
+
+    return err ? fail("couldn't pack file", out_name) : EXIT_SUCCESS;
+}
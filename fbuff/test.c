@@ -2,37 +2,97 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define TEST_POSIX
+#include <unistd.h>
+#include <pthread.h>
+#endif
 #include "fbuff.h"
+#include "fbscan.h"
+#include "fbrec.h"
+#include "fbfind.h"
+#include "fbreadv.h"
+#include "fbwrite.h"
+#include "fbpool.h"
+#include "fbset.h"
 #include "test.h"
 //------------------------------------------------------------------------------
 
 void run_tests(void);
 bool test_fbuff_init(void);
+bool test_fbuff_init_fd(void);
+bool test_fbuff_init_mmap(void);
+bool test_fbuff_init_prefetch(void);
+bool test_fbuff_init_uring(void);
+bool test_fbuff_init_direct(void);
+bool test_fbuff_init_decomp(void);
+bool test_fbuff_stream(void);
+bool test_fbuff_init_pool(void);
 bool test_fbuff_read(void);
 bool test_fbuff_set_offset(void);
+bool test_fbuff_advise(void);
+bool test_fbuff_pattern(void);
+bool test_fbuff_get(void);
+bool test_fbuff_read_at(void);
+bool test_fbuff_set_cache(void);
+bool test_fbuff_set_auto(void);
+bool test_fbuff_set_follow(void);
+bool test_fbuff_stats(void);
 bool test_fbuff_reset(void);
 bool test_fbuff_free(void);
 bool test_fbuff_fp(void);
+bool test_fbuff_fd(void);
 bool test_fbuff_state(void);
 bool test_fbuff_buff_size(void);
 bool test_fbuff_file_size(void);
 bool test_fbuff_data(void);
 bool test_fbuff_last_read(void);
 bool test_fbuff_all_read(void);
+bool test_fbuff_scan(void);
+bool test_fbuff_next_record(void);
+bool test_fbuff_find(void);
+bool test_fbuff_readv(void);
+bool test_fbuff_writer(void);
+bool test_fbuff_pool(void);
+bool test_fbuff_fileset(void);
 
 static ftest tests[] = {
     test_fbuff_init,
+    test_fbuff_init_fd,
+    test_fbuff_init_mmap,
+    test_fbuff_init_prefetch,
+    test_fbuff_init_uring,
+    test_fbuff_init_direct,
+    test_fbuff_init_decomp,
+    test_fbuff_stream,
+    test_fbuff_init_pool,
     test_fbuff_free,
     test_fbuff_read,
     test_fbuff_set_offset,
+    test_fbuff_advise,
+    test_fbuff_pattern,
+    test_fbuff_get,
+    test_fbuff_read_at,
+    test_fbuff_set_cache,
+    test_fbuff_set_auto,
+    test_fbuff_set_follow,
+    test_fbuff_stats,
     test_fbuff_reset,
     test_fbuff_fp,
+    test_fbuff_fd,
     test_fbuff_state,
     test_fbuff_buff_size,
     test_fbuff_file_size,
     test_fbuff_data,
     test_fbuff_last_read,
     test_fbuff_all_read,
+    test_fbuff_scan,
+    test_fbuff_next_record,
+    test_fbuff_find,
+    test_fbuff_readv,
+    test_fbuff_writer,
+    test_fbuff_pool,
+    test_fbuff_fileset,
 };
 
 //------------------------------------------------------------------------------
@@ -115,6 +175,657 @@ bool test_fbuff_init(void)
 }
 //------------------------------------------------------------------------------
 
+bool test_fbuff_init_fd(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    FILE * tfile = tfopen();
+    int fd = fileno(tfile);
+
+    check(fbuff_init_fd(NULL, fd, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_fd(btest, -1, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_fd(btest, fd, 0) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    int bsz = 10;
+    check(fbuff_init_fd(btest, fd, bsz) == 0);
+    check(fbuff_file_size(btest) == all);
+
+    FILE * fp = (FILE *)1;
+    int out_fd = -1;
+    check(fbuff_fp(btest, &fp) == 0);
+    check(NULL == fp);
+    check(fbuff_fd(btest, &out_fd) == 0);
+    check(fd == out_fd);
+
+    byte * out = NULL;
+    check(fbuff_data(btest, &out) == 0);
+    check(fbuff_read(btest, 3) == 3);
+    check(memcmp(out, "The", 3) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(memcmp(out, &test_str[3], bsz) == 0);
+    check(fbuff_state(btest) == 0);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 6);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(memcmp(out, &test_str[all-6], 6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 0);
+
+    check(fbuff_reset(btest) == 0);
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+        continue;
+    check(fbuff_all_read(btest) == all);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_free(btest) == 0);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_init_mmap(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    FILE * tfile = tfopen();
+
+    check(fbuff_init_mmap(NULL, tfile, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_mmap(btest, NULL, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_mmap(btest, tfile, 0) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    int bsz = 10;
+    check(fbuff_init_mmap(btest, tfile, bsz) == 0);
+    check(fbuff_buff_size(btest) == bsz);
+    check(fbuff_file_size(btest) == all);
+    check(fbuff_state(btest) == 0);
+
+    byte * out = NULL;
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, "The", 3) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[3], bsz) == 0);
+    check(fbuff_all_read(btest) == 3+bsz);
+    check(fbuff_read(btest, bsz+1) == FBUFF_BAD_ARG);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 6);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[all-6], 6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 0);
+    check(fbuff_last_read(btest) == 0);
+    check(fbuff_set_offset(btest, 421) == FBUFF_BAD_OFFSET);
+
+    check(fbuff_reset(btest) == 0);
+    check(fbuff_state(btest) == 0);
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+        continue;
+    check(fbuff_all_read(btest) == all);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_free(btest) == 0);
+    check(NULL == btest->data);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_init_prefetch(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    FILE * tfile = tfopen();
+
+    check(fbuff_init_prefetch(NULL, tfile, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_prefetch(btest, NULL, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_prefetch(btest, tfile, 0) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    int bsz = 10;
+    check(fbuff_init_prefetch(btest, tfile, bsz) == 0);
+    check(fbuff_buff_size(btest) == bsz);
+    check(fbuff_file_size(btest) == all);
+
+    byte * out = NULL;
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, test_str, bsz) == 0);
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[bsz], 3) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[bsz+3], bsz) == 0);
+    check(fbuff_all_read(btest) == bsz+3+bsz);
+    check(fbuff_state(btest) == 0);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 6);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[all-6], 6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 0);
+
+    check(fbuff_reset(btest) == 0);
+    check(fbuff_state(btest) == 0);
+    int i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(fbuff_data(btest, &out) == 0);
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(fbuff_all_read(btest) == all);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_free(btest) == 0);
+    check(NULL == btest->data);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_init_uring(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    FILE * tfile = tfopen();
+
+    check(fbuff_init_uring(NULL, tfile, 123, 4) == FBUFF_BAD_ARG);
+    check(fbuff_init_uring(btest, NULL, 123, 4) == FBUFF_BAD_ARG);
+    check(fbuff_init_uring(btest, tfile, 0, 4) == FBUFF_BAD_ARG);
+    check(fbuff_init_uring(btest, tfile, 123, 0) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    int bsz = 4;
+    check(fbuff_init_uring(btest, tfile, bsz, 3) == 0);
+    check(fbuff_file_size(btest) == all);
+
+    byte * out = NULL;
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, test_str, bsz) == 0);
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[bsz], 3) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[bsz+3], bsz) == 0);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_read(btest, FBUFF_FILL) == 2);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[all-2], 2) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 0);
+
+    check(fbuff_reset(btest) == 0);
+    int i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(fbuff_data(btest, &out) == 0);
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(fbuff_all_read(btest) == all);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_free(btest) == 0);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_init_direct(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    FILE * tfile = tfopen();
+
+    check(fbuff_init_direct(NULL, tfile, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_direct(btest, NULL, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_direct(btest, tfile, 0) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    int bsz = 10;
+    check(fbuff_init_direct(btest, tfile, bsz) == 0);
+    check(fbuff_buff_size(btest) == bsz);
+    check(fbuff_file_size(btest) == all);
+
+    byte * out = NULL;
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, "The", 3) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[3], bsz) == 0);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 6);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[all-6], 6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 0);
+
+    check(fbuff_reset(btest) == 0);
+    int i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(fbuff_data(btest, &out) == 0);
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(all == i);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_free(btest) == 0);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+// test_str as two gzip members, split after "fox "
+static const byte test_gz[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x0b, 0xc9,
+    0x48, 0x55, 0x28, 0x2c, 0xcd, 0x4c, 0xce, 0x56, 0x48, 0x2a, 0xca, 0x2f,
+    0xcf, 0x53, 0x48, 0xcb, 0xaf, 0x50, 0x00, 0x00, 0xe2, 0x75, 0xb0, 0x88,
+    0x14, 0x00, 0x00, 0x00, 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x02, 0x03, 0xcb, 0x2a, 0xcd, 0x2d, 0x28, 0x56, 0xc8, 0x2f, 0x4b, 0x2d,
+    0x52, 0x28, 0xc9, 0x48, 0x55, 0xc8, 0x49, 0xac, 0xaa, 0x54, 0x48, 0xc9,
+    0x4f, 0xd7, 0xe3, 0x02, 0x00, 0x50, 0x51, 0xf0, 0x6c, 0x19, 0x00, 0x00,
+    0x00,
+};
+
+#ifdef FBUFF_ZSTD
+// test_str as two zstd frames with content sizes, split after "fox "
+static const byte test_zst[] = {
+    0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x14, 0xa1, 0x00, 0x00, 0x54, 0x68, 0x65,
+    0x20, 0x71, 0x75, 0x69, 0x63, 0x6b, 0x20, 0x62, 0x72, 0x6f, 0x77, 0x6e,
+    0x20, 0x66, 0x6f, 0x78, 0x20, 0x94, 0xaa, 0xe6, 0x0f, 0x28, 0xb5, 0x2f,
+    0xfd, 0x24, 0x19, 0xc9, 0x00, 0x00, 0x6a, 0x75, 0x6d, 0x70, 0x73, 0x20,
+    0x6f, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6c, 0x61, 0x7a,
+    0x79, 0x20, 0x64, 0x6f, 0x67, 0x2e, 0x0a, 0x53, 0x69, 0x21, 0xd0,
+};
+#endif
+
+#ifdef FBUFF_LZ4
+// test_str as two lz4 frames with content sizes, split after "fox "
+static const byte test_lz4[] = {
+    0x04, 0x22, 0x4d, 0x18, 0x6c, 0x40, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x4d, 0x14, 0x00, 0x00, 0x80, 0x54, 0x68, 0x65, 0x20, 0x71,
+    0x75, 0x69, 0x63, 0x6b, 0x20, 0x62, 0x72, 0x6f, 0x77, 0x6e, 0x20, 0x66,
+    0x6f, 0x78, 0x20, 0x00, 0x00, 0x00, 0x00, 0x09, 0xab, 0x7d, 0x7d, 0x04,
+    0x22, 0x4d, 0x18, 0x6c, 0x40, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x6c, 0x19, 0x00, 0x00, 0x80, 0x6a, 0x75, 0x6d, 0x70, 0x73, 0x20,
+    0x6f, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6c, 0x61, 0x7a,
+    0x79, 0x20, 0x64, 0x6f, 0x67, 0x2e, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x1c,
+    0x24, 0xa7, 0x72,
+};
+#endif
+
+#if defined(FBUFF_ZSTD) || defined(FBUFF_LZ4)
+static bool decomp_frames(const byte * frames, size_t len, size_t first)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    byte * out = NULL;
+    int all = strlen(test_str);
+
+    FILE * pfile = tmpfile();
+    check(pfile != NULL);
+    check(fwrite(frames, 1, first, pfile) == first);
+    check(fflush(pfile) == 0);
+    check(fbuff_init_decomp(btest, pfile, 64) == 0);
+    check(fbuff_file_size(btest) == 20);
+    check(fbuff_read(btest, FBUFF_FILL) == 20);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, test_str, 20) == 0);
+    check(fbuff_free(btest) == 0);
+
+    rewind(pfile);
+    check(fwrite(frames, 1, len, pfile) == len);
+    check(fflush(pfile) == 0);
+    check(fbuff_init_decomp(btest, pfile, 64) == 0);
+    check(fbuff_file_size(btest) == FBUFF_NO_SIZE);
+    check(fbuff_set_offset(btest, 30) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == all - 30);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[30], all - 30) == 0);
+    check(fbuff_file_size(btest) == all);
+    check(fbuff_free(btest) == 0);
+
+    fclose(pfile);
+    return true;
+}
+/** Checks that only a file of a single frame takes its size from the frame
+header, first being the length of that frame in frames. */
+#endif
+
+// test_str in fbz with zlib and 8 byte blocks, made by fbzpack
+static const byte test_fbz[] = {
+    0x46, 0x42, 0x5a, 0x31, 0x01, 0x00, 0x00, 0x00, 0x78, 0x9c, 0x0b, 0xc9,
+    0x48, 0x55, 0x28, 0x2c, 0xcd, 0x4c, 0x06, 0x00, 0x0c, 0xd6, 0x02, 0xf4,
+    0x78, 0x9c, 0xcb, 0x56, 0x48, 0x2a, 0xca, 0x2f, 0xcf, 0x53, 0x00, 0x00,
+    0x0c, 0xe3, 0x02, 0xd4, 0x78, 0x9c, 0x4b, 0xcb, 0xaf, 0x50, 0xc8, 0x2a,
+    0xcd, 0x2d, 0x00, 0x00, 0x0e, 0x02, 0x03, 0x2a, 0x78, 0x9c, 0x2b, 0x56,
+    0xc8, 0x2f, 0x4b, 0x2d, 0x52, 0x28, 0x01, 0x00, 0x0d, 0x06, 0x02, 0xe4,
+    0x78, 0x9c, 0xcb, 0x48, 0x55, 0xc8, 0x49, 0xac, 0xaa, 0x54, 0x00, 0x00,
+    0x0c, 0xeb, 0x02, 0xce, 0x78, 0x9c, 0x4b, 0xc9, 0x4f, 0xd7, 0xe3, 0x02,
+    0x00, 0x05, 0x50, 0x01, 0x73, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x28, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x58, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x65, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2d, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x65, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46, 0x42, 0x5a,
+    0x31,
+};
+
+bool test_fbuff_init_decomp(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    FILE * tfile = tfopen();
+
+    check(fbuff_init_decomp(NULL, tfile, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_decomp(btest, NULL, 123) == FBUFF_BAD_ARG);
+    check(fbuff_init_decomp(btest, tfile, 0) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    int bsz = 10;
+    byte * out = NULL;
+    check(fbuff_init_decomp(btest, tfile, bsz) == 0);
+    check(fbuff_file_size(btest) == all);
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, "The", 3) == 0);
+    check(fbuff_free(btest) == 0);
+    fclose(tfile);
+
+    FILE * gzfile = tmpfile();
+    check(gzfile != NULL);
+    check(fwrite(test_gz, 1, sizeof(test_gz), gzfile) == sizeof(test_gz));
+    check(fflush(gzfile) == 0);
+
+#ifdef FBUFF_ZLIB
+    byte dst[3];
+    check(fbuff_init_decomp(btest, gzfile, bsz) == 0);
+    check(fbuff_file_size(btest) == FBUFF_NO_SIZE);
+    check(fbuff_read_at(btest, 0, 3, dst) == FBUFF_BAD_ARG);
+    check(fbuff_set_offset(btest, -1) == FBUFF_BAD_OFFSET);
+    check(fbuff_set_offset(btest, all + 5) == FBUFF_BAD_OFFSET);
+    check(fbuff_file_size(btest) == all);
+
+    check(fbuff_set_offset(btest, 16) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[16], bsz) == 0);
+
+    check(fbuff_set_offset(btest, 4) == 0);
+    check(fbuff_read(btest, 5) == 5);
+    check(memcmp(out, "quick", 5) == 0);
+
+    check(fbuff_reset(btest) == 0);
+    int i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(all == i);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 6);
+    check(memcmp(out, &test_str[all-6], 6) == 0);
+    check(fbuff_free(btest) == 0);
+#else
+    check(fbuff_init_decomp(btest, gzfile, bsz) == FBUFF_FERR);
+    check(NULL == btest->data);
+    check(fbuff_free(btest) == 0);
+#endif
+    fclose(gzfile);
+
+#ifdef FBUFF_ZSTD
+    check(decomp_frames(test_zst, sizeof(test_zst), 33));
+#endif
+#ifdef FBUFF_LZ4
+    check(decomp_frames(test_lz4, sizeof(test_lz4), 47));
+#endif
+
+    FILE * fbzfile = tmpfile();
+    check(fbzfile != NULL);
+    check(fwrite(test_fbz, 1, sizeof(test_fbz), fbzfile) == sizeof(test_fbz));
+    check(fflush(fbzfile) == 0);
+
+#ifdef FBUFF_ZLIB
+    check(fbuff_init_decomp(btest, fbzfile, bsz) == 0);
+    check(fbuff_file_size(btest) == all);
+    check(fbuff_data(btest, &out) == 0);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 6);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(memcmp(out, &test_str[all-6], 6) == 0);
+
+    check(fbuff_set_offset(btest, 6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(memcmp(out, &test_str[6], bsz) == 0);
+    check(fbuff_get_offset(btest) == 6 + bsz);
+    check(fbuff_set_offset(btest, all + 1) == FBUFF_BAD_OFFSET);
+
+    check(fbuff_reset(btest) == 0);
+    i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(all == i);
+    check(fbuff_free(btest) == 0);
+#else
+    check(fbuff_init_decomp(btest, fbzfile, bsz) == FBUFF_FERR);
+    check(NULL == btest->data);
+    check(fbuff_free(btest) == 0);
+#endif
+
+    fclose(fbzfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+#ifdef TEST_POSIX
+static FILE * stream_open(void)
+{
+    int fds[2];
+    ssize_t len = strlen(test_str);
+
+    if (pipe(fds) != 0)
+        return NULL;
+    if (write(fds[1], test_str, len) != len)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+    close(fds[1]);
+    return fdopen(fds[0], rb);
+}
+#endif
+
+bool test_fbuff_stream(void)
+{
+#ifdef TEST_POSIX
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    fbuff_off all = strlen(test_str);
+    fbuff_off ofs;
+    byte * out, * ptr;
+    byte dst[4];
+
+    FILE * sfile = stream_open();
+    check(sfile != NULL);
+    check(fbuff_init(btest, sfile, 8) == 0);
+    check(fbuff_file_size(btest) == FBUFF_NO_SIZE);
+    check(fbuff_read_at(btest, 0, 4, dst) == FBUFF_BAD_ARG);
+    check(fbuff_set_cache(btest, 8, 16) == FBUFF_BAD_ARG);
+    check(fbuff_set_follow(btest, 1, 0) == FBUFF_BAD_ARG);
+    check(fbuff_set_offset(btest, -1) == FBUFF_BAD_OFFSET);
+    check(fbuff_data(btest, &out) == 0);
+
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(memcmp(out, test_str, 8) == 0);
+    check(fbuff_set_offset(btest, 2) == 0);
+    check(fbuff_read(btest, 4) == 4);
+    check(memcmp(out, &test_str[2], 4) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(memcmp(out, &test_str[6], 8) == 0);
+    check(fbuff_set_offset(btest, 5) == FBUFF_BAD_OFFSET);
+    check(fbuff_reset(btest) == FBUFF_BAD_OFFSET);
+
+    check(fbuff_set_offset(btest, 30) == 0);
+    check(fbuff_get_offset(btest) == 30);
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(memcmp(out, &test_str[30], 8) == 0);
+    check(fbuff_get(btest, 34, 4, &ptr) == 4);
+    check(memcmp(ptr, &test_str[34], 4) == 0);
+    check(fbuff_file_size(btest) == FBUFF_NO_SIZE);
+
+    check(fbuff_read(btest, FBUFF_FILL) == all - 38);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_file_size(btest) == all);
+    check(fbuff_set_offset(btest, all + 1) == FBUFF_BAD_OFFSET);
+    check(fbuff_set_offset(btest, -3) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 3);
+    check(memcmp(out, &test_str[all - 3], 3) == 0);
+    fbuff_free(btest);
+    fclose(sfile);
+
+    sfile = stream_open();
+    check(sfile != NULL);
+    check(fbuff_init_fd(btest, fileno(sfile), 4) == 0);
+    check(fbuff_find(btest, (const byte *)"brown", 5, &ofs) ==
+        FBUFF_BAD_OFFSET);
+    check(10 == ofs);
+    fbuff_free(btest);
+    fclose(sfile);
+
+    sfile = stream_open();
+    check(sfile != NULL);
+    check(fbuff_init_fd(btest, fileno(sfile), 8) == 0);
+    check(fbuff_data(btest, &out) == 0);
+    check(fbuff_find(btest, (const byte *)"lazy", 4, &ofs) == 0);
+    check(35 == ofs);
+    check(fbuff_read(btest, 4) == 4);
+    check(memcmp(out, "lazy", 4) == 0);
+    check(fbuff_set_offset(btest, all + 10) == FBUFF_BAD_OFFSET);
+    check(fbuff_file_size(btest) == all);
+    check(fbuff_get_offset(btest) == all);
+    fbuff_free(btest);
+    fclose(sfile);
+
+    sfile = stream_open();
+    check(sfile != NULL);
+    check(fbuff_init_prefetch(btest, sfile, 16) == 0);
+    check(fbuff_data(btest, &out) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 16);
+    check(memcmp(out, test_str, 16) == 0);
+    fbuff_free(btest);
+    check(fbuff_init_decomp(btest, sfile, 16) == FBUFF_FERR);
+    check(NULL == btest->data);
+    fbuff_free_null(btest);
+    fclose(sfile);
+#endif
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_init_pool(void)
+{
+    fbuff btest_, bother_;
+    fbuff * btest = &btest_;
+    fbuff * bother = &bother_;
+    fbuff_pool * pool;
+    fbuff_pool_usage use;
+    byte * out, * first;
+
+    int bsz = 10;
+    int all = strlen(test_str);
+    FILE * tfile = tfopen();
+
+    check(fbuff_pool_new(&pool, 0, 0, 0) == 0);
+    check(fbuff_init_pool(NULL, tfile, bsz, pool) == FBUFF_BAD_ARG);
+    check(fbuff_init_pool(btest, NULL, bsz, pool) == FBUFF_BAD_ARG);
+    check(fbuff_init_pool(btest, tfile, 0, pool) == FBUFF_BAD_ARG);
+    check(fbuff_init_pool(btest, tfile, FBPOOL_MAX_SIZE + 1, pool) ==
+        FBUFF_BAD_ARG);
+    check(fbuff_init_pool(btest, tfile, bsz, NULL) == FBUFF_BAD_ARG);
+
+    check(fbuff_init_pool(btest, tfile, bsz, pool) == 0);
+    check(fbuff_buff_size(btest) == bsz);
+    check(fbuff_file_size(btest) == all);
+    check(fbuff_data(btest, &first) == 0);
+
+    int i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(memcmp(first, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(all == i);
+
+    check(fbuff_set_auto(btest, 2, FBPOOL_MIN_CLASS + 1) == FBUFF_BAD_ARG);
+    check(fbuff_set_auto(btest, 2, FBPOOL_MIN_CLASS) == 0);
+    check(fbuff_data(btest, &out) == 0);
+    check(out == first);
+    check(fbuff_free(btest) == 0);
+
+    check(fbuff_init_pool(btest, tfile, 2 * bsz, pool) == 0);
+    check(fbuff_data(btest, &out) == 0);
+    check(out == first);
+    check(fbuff_pool_stats(pool, &use) == 0);
+    check(1 == use.allocs);
+    check(FBPOOL_MIN_CLASS == use.held);
+    check(fbuff_free(btest) == 0);
+    check(fbuff_pool_free(pool) == 0);
+
+    check(fbuff_pool_new(&pool, FBPOOL_MIN_CLASS, 0, 0) == 0);
+    check(fbuff_init_pool(btest, tfile, bsz, pool) == 0);
+    check(fbuff_init_pool(bother, tfile, bsz, pool) == FBUFF_BAD_ALLOC);
+    check(fbuff_free(btest) == 0);
+    check(fbuff_init_pool(bother, tfile, bsz, pool) == 0);
+    check(fbuff_read(bother, 4) == 4);
+    check(fbuff_data(bother, &out) == 0);
+    check(memcmp(out, test_str, 4) == 0);
+    fbuff_free_null(bother);
+    check(fbuff_pool_free(pool) == 0);
+
+#ifdef TEST_POSIX
+    FILE * bad = tmpfile();
+    check(bad != NULL);
+    close(fileno(bad));
+    check(fbuff_pool_new(&pool, FBPOOL_MIN_CLASS, 0, 0) == 0);
+    check(fbuff_init_pool(btest, bad, bsz, pool) == FBUFF_FERR);
+    fclose(bad);
+    check(NULL == btest->data);
+    check(fbuff_init_pool(btest, tfile, bsz, pool) == 0);
+    check(fbuff_pool_stats(pool, &use) == 0);
+    check(1 == use.allocs);
+    fbuff_free(btest);
+    check(fbuff_pool_free(pool) == 0);
+#endif
+
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
 bool test_fbuff_free(void)
 {
     fbuff btest_;
@@ -271,74 +982,603 @@ bool test_fbuff_read(void)
 
     fbuff_free_null(btest);
     fclose(tfile);
-	return true;
+	return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_set_offset(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+
+    check(fbuff_set_offset(NULL, 5) == FBUFF_BAD_ARG);
+
+    int test_str_size = strlen(test_str);
+    int bsz = 5;
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, bsz) == 0);
+    check(fbuff_file_size(btest) == test_str_size);
+
+    check(fbuff_get_offset(NULL) == FBUFF_BAD_ARG);
+    check(fbuff_get_offset(btest) == 0);
+    check(fbuff_set_offset(btest, bsz) == 0);
+    check(ftell(tfile) == bsz);
+    check(fbuff_get_offset(btest) == bsz);
+
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_get_offset(btest) == bsz+bsz);
+    check(ferror(tfile) == 0);
+    check(fbuff_state(btest) == 0);
+    byte * out;
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[bsz], bsz) == 0);
+    check(ftell(tfile) == bsz+bsz);
+    check(ferror(tfile) == 0);
+    check(fbuff_file_size(btest) == test_str_size);
+
+    check(fbuff_set_offset(btest, bsz) == 0);
+    check(ftell(tfile) == bsz);
+    check(fbuff_set_offset(btest, -6) == 0);
+
+    int ofs = test_str_size - 6;
+    check(ftell(tfile) == ofs);
+
+    int read = 3;
+    check(fbuff_read(btest, read) == read);
+    check(fbuff_state(btest) == 0);
+
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[ofs], read) == 0);
+    check(ftell(tfile) == ofs+read);
+    check(fbuff_file_size(btest) == test_str_size);
+
+    check(fbuff_read(btest, FBUFF_FILL) > 0);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_data(btest, &out) == 0);
+    read = fbuff_last_read(btest);
+    check(memcmp(out, &test_str[test_str_size - read], read) == 0);
+    check(ftell(tfile) == test_str_size);
+    check(fbuff_file_size(btest) == test_str_size);
+
+    check(fbuff_set_offset(btest, 421) == FBUFF_BAD_OFFSET);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_read(btest, FBUFF_FILL) == 0);
+    check(fbuff_last_read(btest) == 0);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_set_offset(btest, -231) == FBUFF_BAD_OFFSET);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_read(btest, FBUFF_FILL) == 0);
+    check(fbuff_last_read(btest) == 0);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_file_size(btest) == test_str_size);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_advise(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+
+    check(fbuff_advise(NULL, FBUFF_ADV_RANDOM, 0, 0) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 4) == 0);
+    check(fbuff_advise(btest, -1, 0, 0) == FBUFF_BAD_ARG);
+    check(fbuff_advise(btest, FBUFF_ADV_DONTNEED+1, 0, 0) == FBUFF_BAD_ARG);
+    check(fbuff_advise(btest, FBUFF_ADV_WILLNEED, 0, -1) == FBUFF_BAD_ARG);
+    check(fbuff_advise(btest, FBUFF_ADV_WILLNEED, all+1, 0) == FBUFF_BAD_OFFSET);
+    check(fbuff_advise(btest, FBUFF_ADV_WILLNEED, -5, 5) == 0);
+    check(fbuff_advise(btest, FBUFF_ADV_DONTNEED, 0, 0) == 0);
+    check(fbuff_advise(btest, FBUFF_ADV_RANDOM, 0, 0) == 0);
+    check(fbuff_advise(btest, FBUFF_ADV_SEQUENTIAL, 0, 0) == 0);
+
+    byte * out;
+    int i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(fbuff_data(btest, &out) == 0);
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(all == i);
+    fbuff_free(btest);
+
+    check(fbuff_init_mmap(btest, tfile, 4) == 0);
+    check(fbuff_advise(btest, FBUFF_ADV_SEQUENTIAL, 0, 0) == 0);
+    i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(fbuff_data(btest, &out) == 0);
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(all == i);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_pattern(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    byte * out;
+
+    check(fbuff_pattern(NULL) == FBUFF_BAD_ARG);
+
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 4) == 0);
+    check(fbuff_pattern(btest) == FBUFF_PAT_NONE);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(fbuff_pattern(btest) == FBUFF_PAT_NONE);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_SEQUENTIAL);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(fbuff_pattern(btest) == FBUFF_PAT_SEQUENTIAL);
+
+    check(fbuff_set_offset(btest, 20) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_NONE);
+    check(fbuff_set_offset(btest, 30) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_NONE);
+    check(fbuff_set_offset(btest, 40) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_STRIDED);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[40], 2) == 0);
+
+    check(fbuff_set_offset(btest, 30) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_NONE);
+    check(fbuff_set_offset(btest, 20) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_REVERSE);
+    check(fbuff_set_offset(btest, 10) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_REVERSE);
+    check(fbuff_set_offset(btest, 10) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_NONE);
+
+    check(fbuff_advise(btest, FBUFF_ADV_RANDOM, 0, 0) == 0);
+    check(fbuff_reset(btest) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_NONE);
+    check(fbuff_advise(btest, FBUFF_ADV_NORMAL, 0, 0) == 0);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_read(btest, 2) == 2);
+    check(fbuff_pattern(btest) == FBUFF_PAT_SEQUENTIAL);
+    fbuff_free(btest);
+
+    check(fbuff_init_mmap(btest, tfile, 4) == 0);
+    int i;
+    for (i = 3; i >= 0; --i)
+    {
+        check(fbuff_set_offset(btest, i * 12) == 0);
+        check(fbuff_read(btest, 3) == 3);
+        check(fbuff_data(btest, &out) == 0);
+        check(memcmp(out, &test_str[i * 12], 3) == 0);
+    }
+    check(fbuff_pattern(btest) == FBUFF_PAT_REVERSE);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_get(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    byte * ptr = NULL;
+
+    check(fbuff_get(NULL, 0, 1, &ptr) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 8) == 0);
+    check(fbuff_get(btest, 0, 1, NULL) == FBUFF_BAD_ARG);
+    check(fbuff_get(btest, 0, -1, &ptr) == FBUFF_BAD_ARG);
+    check(fbuff_get(btest, 0, 9, &ptr) == FBUFF_BAD_ARG);
+    check(fbuff_get(btest, all+1, 1, &ptr) == FBUFF_BAD_OFFSET);
+
+    check(fbuff_get(btest, 10, 5, &ptr) == 5);
+    check(memcmp(ptr, "brown", 5) == 0);
+    check(fbuff_get_offset(btest) == 16);
+    check(fbuff_all_read(btest) == 8);
+
+    check(fbuff_get(btest, 8, 3, &ptr) == 3);
+    check(memcmp(ptr, "k b", 3) == 0);
+    check(fbuff_all_read(btest) == 8);
+    check(fbuff_get(btest, 7, 8, &ptr) == 8);
+    check(memcmp(ptr, "ck brown", 8) == 0);
+    check(fbuff_all_read(btest) == 16);
+    check(fbuff_get_offset(btest) == 15);
+
+    check(fbuff_get(btest, 4, 3, &ptr) == 3);
+    check(memcmp(ptr, "qui", 3) == 0);
+    check(fbuff_get_offset(btest) == 10);
+    check(fbuff_all_read(btest) == 24);
+
+    check(fbuff_get(btest, 20, 7, &ptr) == 7);
+    check(memcmp(ptr, "jumps o", 7) == 0);
+    check(fbuff_get_offset(btest) == 27);
+    check(fbuff_get(btest, 31, 8, &ptr) == 8);
+    check(memcmp(ptr, "the lazy", 8) == 0);
+
+    check(fbuff_get(btest, -3, 8, &ptr) == 3);
+    check(memcmp(ptr, &test_str[all-3], 3) == 0);
+
+    fbuff_free(btest);
+    check(fbuff_init_mmap(btest, tfile, 8) == 0);
+    check(fbuff_get(btest, 10, 5, &ptr) == 5);
+    check(memcmp(ptr, "brown", 5) == 0);
+    check(fbuff_all_read(btest) == 0);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_read_at(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    byte dst[64];
+
+    check(fbuff_read_at(NULL, 0, 1, dst) == FBUFF_BAD_ARG);
+    check(fbuff_read_at(btest, 0, 1, NULL) == FBUFF_BAD_ARG);
+    check(fbuff_read_at(btest, 0, -1, dst) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 5) == 0);
+    check(fbuff_read(btest, 3) == 3);
+
+    check(fbuff_read_at(btest, 4, 5, dst) == 5);
+    check(memcmp(dst, "quick", 5) == 0);
+    check(fbuff_read_at(btest, -5, 20, dst) == 5);
+    check(memcmp(dst, &test_str[all-5], 5) == 0);
+    check(fbuff_read_at(btest, all, 20, dst) == 0);
+    check(fbuff_read_at(btest, all+1, 20, dst) == FBUFF_BAD_OFFSET);
+    check(fbuff_read_at(btest, -(all+1), 20, dst) == FBUFF_BAD_OFFSET);
+
+    check(ftell(tfile) == 3);
+    check(fbuff_state(btest) == 0);
+    check(fbuff_last_read(btest) == 3);
+    check(fbuff_all_read(btest) == 3);
+    check(fbuff_read(btest, 2) == 2);
+    check(ftell(tfile) == 5);
+
+    fbuff_free(btest);
+    check(fbuff_init_mmap(btest, tfile, 5) == 0);
+    check(fbuff_read_at(btest, 4, 5, dst) == 5);
+    check(memcmp(dst, "quick", 5) == 0);
+    check(fbuff_read_at(btest, 0, sizeof(dst), dst) == all);
+    check(memcmp(dst, test_str, all) == 0);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_set_cache(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    fbuff_off hits, misses;
+
+    check(fbuff_set_cache(NULL, 8, 16) == FBUFF_BAD_ARG);
+    check(fbuff_cache_stats(NULL, &hits, &misses) == FBUFF_BAD_ARG);
+    check(fbuff_cache_stats(btest, NULL, &misses) == FBUFF_BAD_ARG);
+    check(fbuff_cache_stats(btest, &hits, NULL) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 10) == 0);
+    check(fbuff_set_cache(btest, 0, 16) == FBUFF_BAD_ARG);
+    check(fbuff_set_cache(btest, 8, -1) == FBUFF_BAD_ARG);
+    check(fbuff_set_cache(btest, 8, 7) == FBUFF_BAD_ARG);
+    check(fbuff_set_cache(btest, 8, 16) == 0);
+    check(fbuff_cache_stats(btest, &hits, &misses) == 0);
+    check(0 == hits && 0 == misses);
+
+    byte * out = NULL;
+    check(fbuff_data(btest, &out) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 10);
+    check(memcmp(out, test_str, 10) == 0);
+    check(fbuff_cache_stats(btest, &hits, &misses) == 0);
+    check(0 == hits && 2 == misses);
+
+    check(fbuff_set_offset(btest, 4) == 0);
+    check(fbuff_read(btest, 5) == 5);
+    check(memcmp(out, "quick", 5) == 0);
+    check(fbuff_cache_stats(btest, &hits, &misses) == 0);
+    check(2 == hits && 2 == misses);
+
+    check(fbuff_set_offset(btest, -6) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 6);
+    check(memcmp(out, &test_str[all-6], 6) == 0);
+    check(fbuff_state(btest) == FBUFF_EOF);
+    check(fbuff_all_read(btest) == 10+5+6);
+
+    check(fbuff_reset(btest) == 0);
+    int i = 0;
+    while (fbuff_read(btest, FBUFF_FILL) > 0)
+    {
+        check(memcmp(out, &test_str[i], fbuff_last_read(btest)) == 0);
+        i += fbuff_last_read(btest);
+    }
+    check(all == i);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_set_offset(btest, 5) == 0);
+    check(fbuff_set_cache(btest, 8, 0) == 0);
+    check(fbuff_cache_stats(btest, &hits, &misses) == 0);
+    check(0 == hits && 0 == misses);
+    check(ftell(tfile) == 5);
+    check(fbuff_read(btest, 5) == 5);
+    check(memcmp(out, "uick ", 5) == 0);
+
+    fbuff_free(btest);
+    check(fbuff_init_mmap(btest, tfile, 10) == 0);
+    check(fbuff_set_cache(btest, 8, 16) == FBUFF_BAD_ARG);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
 }
 //------------------------------------------------------------------------------
 
-bool test_fbuff_set_offset(void)
+bool test_fbuff_set_auto(void)
 {
     fbuff btest_;
     fbuff * btest = &btest_;
-
-    check(fbuff_set_offset(NULL, 5) == FBUFF_BAD_ARG);
-
-    int test_str_size = strlen(test_str);
-    int bsz = 5;
     FILE * tfile = tfopen();
-    check(fbuff_init(btest, tfile, bsz) == 0);
-    check(fbuff_file_size(btest) == test_str_size);
 
-    check(fbuff_set_offset(btest, bsz) == 0);
-    check(ftell(tfile) == bsz);
+    check(fbuff_set_auto(NULL, 2, 16) == FBUFF_BAD_ARG);
+
+    check(fbuff_init(btest, tfile, 4) == 0);
+    check(fbuff_set_auto(btest, 0, 16) == FBUFF_BAD_ARG);
+    check(fbuff_set_auto(btest, 8, 4) == FBUFF_BAD_ARG);
+    check(fbuff_set_auto(btest, 2, 16) == 0);
+    check(fbuff_buff_size(btest) == 4);
 
+    byte * out = NULL;
+    check(fbuff_data(btest, &out) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(memcmp(out, test_str, 4) == 0);
+    check(fbuff_buff_size(btest) == 4);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(memcmp(out, &test_str[4], 4) == 0);
+    check(fbuff_buff_size(btest) == 8);
+
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(memcmp(out, &test_str[16], 8) == 0);
+    fbuff_off bsz = fbuff_buff_size(btest);
+    check(4 == bsz || 16 == bsz);
+
+    check(fbuff_set_offset(btest, 2) == 0);
+    check(fbuff_buff_size(btest) == bsz);
     check(fbuff_read(btest, FBUFF_FILL) == bsz);
-    check(ferror(tfile) == 0);
-    check(fbuff_state(btest) == 0);
-    byte * out;
+    check(memcmp(out, &test_str[2], bsz) == 0);
+
+    check(fbuff_set_offset(btest, 30) == 0);
+    check(fbuff_buff_size(btest) == bsz / 2);
+    check(fbuff_set_offset(btest, 30) == 0);
+    check(fbuff_buff_size(btest) == bsz / 2);
+    check(fbuff_set_offset(btest, 0) == 0);
+    check(fbuff_set_offset(btest, 1) == 0);
+    check(fbuff_set_offset(btest, 2) == 0);
+    check(fbuff_buff_size(btest) == 2);
+
+    check(fbuff_read(btest, 16) == 16);
+    check(memcmp(out, &test_str[2], 16) == 0);
+    check(fbuff_read(btest, 17) == FBUFF_BAD_ARG);
+
+    check(fbuff_set_auto(btest, 8, 8) == 0);
     check(fbuff_data(btest, &out) == 0);
-    check(memcmp(out, &test_str[bsz], bsz) == 0);
-    check(ftell(tfile) == bsz+bsz);
-    check(ferror(tfile) == 0);
-    check(fbuff_file_size(btest) == test_str_size);
+    check(fbuff_buff_size(btest) == 8);
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(memcmp(out, &test_str[34], 8) == 0);
+    check(fbuff_buff_size(btest) == 8);
+    check(fbuff_read(btest, 9) == FBUFF_BAD_ARG);
 
-    check(fbuff_set_offset(btest, bsz) == 0);
-    check(ftell(tfile) == bsz);
-    check(fbuff_set_offset(btest, -6) == 0);
+    fbuff_free(btest);
+    check(fbuff_init(btest, tfile, 4) == 0);
+    check(fbuff_set_auto(btest, 2, 16) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(fbuff_buff_size(btest) == 8);
+    check(fbuff_get(btest, 30, 8, &out) == 8);
+    check(memcmp(out, &test_str[30], 8) == 0);
+    check(fbuff_get(btest, 2, 8, &out) == 8);
+    check(memcmp(out, &test_str[2], 8) == 0);
+    check(fbuff_buff_size(btest) >= 8);
 
-    int ofs = test_str_size - 6;
-    check(ftell(tfile) == ofs);
+    fbuff_free(btest);
+    check(fbuff_init_mmap(btest, tfile, 10) == 0);
+    check(fbuff_set_auto(btest, 2, 16) == FBUFF_BAD_ARG);
 
-    int read = 3;
-    check(fbuff_read(btest, read) == read);
-    check(fbuff_state(btest) == 0);
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
 
-    check(fbuff_data(btest, &out) == 0);
-    check(memcmp(out, &test_str[ofs], read) == 0);
-    check(ftell(tfile) == ofs+read);
-    check(fbuff_file_size(btest) == test_str_size);
+#ifdef TEST_POSIX
+static void * follow_writer(void * arg)
+{
+    int fd = *(int *)arg;
+    usleep(20000);
+    if (pwrite(fd, &test_str[20], 5, 20) != 5)
+        return arg;
+    return NULL;
+}
+#endif
 
-    check(fbuff_read(btest, FBUFF_FILL) > 0);
-    check(fbuff_state(btest) == FBUFF_EOF);
+bool test_fbuff_set_follow(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
 
-    check(fbuff_data(btest, &out) == 0);
-    read = fbuff_last_read(btest);
-    check(memcmp(out, &test_str[test_str_size - read], read) == 0);
-    check(ftell(tfile) == test_str_size);
-    check(fbuff_file_size(btest) == test_str_size);
+    check(fbuff_set_follow(NULL, 1, 0) == FBUFF_BAD_ARG);
 
-    check(fbuff_set_offset(btest, 421) == FBUFF_BAD_OFFSET);
-    check(fbuff_state(btest) == FBUFF_EOF);
+    FILE * tfile = tfopen();
+    check(fbuff_init_mmap(btest, tfile, 8) == 0);
+    check(fbuff_set_follow(btest, 1, 0) == FBUFF_BAD_ARG);
+    fbuff_free(btest);
+    check(fbuff_init(btest, tfile, 8) == 0);
+    check(fbuff_set_cache(btest, 8, 16) == 0);
+    check(fbuff_set_follow(btest, 1, 0) == FBUFF_BAD_ARG);
+    fbuff_free(btest);
+    fclose(tfile);
+
+#ifdef TEST_POSIX
+    char name[] = "/tmp/fbuff_follow_XXXXXX";
+    char moved[sizeof(name) + 4];
+    int wfd = mkstemp(name);
+    check(wfd >= 0);
+    check(pwrite(wfd, test_str, 10, 0) == 10);
+
+    byte * out;
+    FILE * pfile = fopen(name, "rb");
+    check(pfile != NULL);
+    check(fbuff_init(btest, pfile, 8) == 0);
+    check(fbuff_set_follow(btest, 1, 0) == 0);
+    check(fbuff_set_cache(btest, 8, 16) == FBUFF_BAD_ARG);
+    check(fbuff_file_size(btest) == 10);
+
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(fbuff_read(btest, FBUFF_FILL) == 2);
+    check(fbuff_state(btest) == 0);
     check(fbuff_read(btest, FBUFF_FILL) == 0);
-    check(fbuff_last_read(btest) == 0);
-    check(fbuff_state(btest) == FBUFF_EOF);
-    check(fbuff_set_offset(btest, -231) == FBUFF_BAD_OFFSET);
     check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(pwrite(wfd, &test_str[10], 10, 10) == 10);
+    check(fbuff_read(btest, FBUFF_FILL) == 8);
+    check(fbuff_state(btest) == 0);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, &test_str[10], 8) == 0);
+    check(fbuff_file_size(btest) == 18);
+    check(fbuff_read(btest, FBUFF_FILL) == 2);
+    check(fbuff_file_size(btest) == 20);
+
+    pthread_t thread;
+    void * ret = &ret;
+    check(fbuff_set_follow(btest, 1, 5000) == 0);
+    check(pthread_create(&thread, NULL, follow_writer, &wfd) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 5);
+    check(pthread_join(thread, &ret) == 0);
+    check(NULL == ret);
+    check(memcmp(out, &test_str[20], 5) == 0);
+    check(fbuff_file_size(btest) == 25);
+
+    check(fbuff_set_follow(btest, 1, 0) == 0);
+    check(ftruncate(wfd, 4) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == FBUFF_TRUNCATED);
+    check(fbuff_file_size(btest) == 4);
+    check(fbuff_set_offset(btest, 0) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(memcmp(out, test_str, 4) == 0);
+
+    strcpy(moved, name);
+    strcat(moved, ".old");
+    check(rename(name, moved) == 0);
+    check(pwrite(wfd, &test_str[4], 3, 4) == 3);
+    check(fbuff_read(btest, FBUFF_FILL) == 3);
+#ifdef __linux__
+    check(fbuff_read(btest, FBUFF_FILL) == FBUFF_ROTATED);
+#endif
+
+    check(unlink(moved) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == FBUFF_ROTATED);
+
+    check(fbuff_set_follow(btest, 0, 0) == 0);
     check(fbuff_read(btest, FBUFF_FILL) == 0);
-    check(fbuff_last_read(btest) == 0);
     check(fbuff_state(btest) == FBUFF_EOF);
-    check(fbuff_file_size(btest) == test_str_size);
 
     fbuff_free_null(btest);
+    fclose(pfile);
+    close(wfd);
+#endif
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_stats(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    fbuff_io_stats st;
+    FILE * tfile = tfopen();
+
+    int all = strlen(test_str);
+    int bsz = 10;
+    byte dst[8];
+
+    check(fbuff_init(btest, tfile, bsz) == 0);
+    check(fbuff_stats(NULL, &st) == FBUFF_BAD_ARG);
+    check(fbuff_stats(btest, NULL) == FBUFF_BAD_ARG);
+
+    check(fbuff_stats(btest, &st) == 0);
+    check(0 == st.requested);
+    check(0 == st.ops[FBUFF_OP_SEEK].count);
+    fbuff_off init_io = st.ops[FBUFF_OP_IO].count;
+
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_read(btest, FBUFF_FILL) == bsz);
+    check(fbuff_set_offset(btest, -4) == 0);
+    check(fbuff_read(btest, FBUFF_FILL) == 4);
+    check(fbuff_read_at(btest, all - 2, 5, dst) == 2);
+    check(fbuff_stats(btest, &st) == 0);
+
+#ifdef FBUFF_NO_STATS
+    check(0 == st.requested);
+    check(0 == st.ops[FBUFF_OP_READ].count);
+    check(0 == init_io);
+#else
+    check(st.requested == 3 + bsz + bsz + 5);
+    check(st.delivered == 3 + bsz + 4 + 2);
+    check(2 == st.short_reads);
+    check(3 == st.ops[FBUFF_OP_READ].count);
+    check(1 == st.ops[FBUFF_OP_SEEK].count);
+    check(1 == st.ops[FBUFF_OP_READ_AT].count);
+    check(st.ops[FBUFF_OP_IO].count == init_io + 5);
+
+    fbuff_off io = st.ops[FBUFF_OP_IO].count;
+    check(fbuff_read_at(btest, 0, 3, dst) == 3);
+    check(fbuff_stats(btest, &st) == 0);
+    check(st.ops[FBUFF_OP_IO].count == io + 1);
+
+    int i, j;
+    for (i = 0; i < FBUFF_OPS; ++i)
+    {
+        fbuff_off sum = 0;
+        for (j = 0; j < FBUFF_STATS_BUCKETS; ++j)
+            sum += st.ops[i].hist[j];
+        check(sum == st.ops[i].count);
+        check(st.ops[i].ns >= 0);
+    }
+#endif
+
+    check(fbuff_free(btest) == 0);
     fclose(tfile);
     return true;
 }
@@ -395,6 +1635,25 @@ bool test_fbuff_fp(void)
 }
 //------------------------------------------------------------------------------
 
+bool test_fbuff_fd(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+
+    check(fbuff_fd(NULL, (int *)1) == FBUFF_BAD_ARG);
+    check(fbuff_fd(btest, NULL) == FBUFF_BAD_ARG);
+
+    btest->fd = 123;
+    check(123 == btest->fd);
+
+    int out = -1;
+    check(fbuff_fd(btest, &out) == 0);
+    check(123 == out);
+
+    return true;
+}
+//------------------------------------------------------------------------------
+
 bool test_fbuff_state(void)
 {
     fbuff btest_;
@@ -439,6 +1698,9 @@ bool test_fbuff_file_size(void)
 
     check(fbuff_file_size(btest) == 321);
 
+    btest->file_size = 5000000000LL;
+    check(fbuff_file_size(btest) == 5000000000LL);
+
 	return true;
 }
 //------------------------------------------------------------------------------
@@ -491,10 +1753,648 @@ bool test_fbuff_all_read(void)
 
     check(fbuff_all_read(btest) == 123456);
 
+    btest->all_bytes_read = 5000000000LL;
+    check(fbuff_all_read(btest) == 5000000000LL);
+
 	return true;
 }
 //------------------------------------------------------------------------------
 
+#define SCAN_WORKERS 4
+typedef struct scan_ctx {
+    int bytes[SCAN_WORKERS];
+    int bad[SCAN_WORKERS];
+    int total;
+} scan_ctx;
+
+static int scan_chunk(int worker, const byte * data, fbuff_off offset,
+    fbuff_off len, void * arg)
+{
+    scan_ctx * ctx = arg;
+    if (memcmp(data, &test_str[offset], len) != 0 ||
+        (offset > 0 && test_str[offset-1] != ' ' && test_str[offset-1] != '\n'))
+        ++ctx->bad[worker];
+    ctx->bytes[worker] += len;
+    return 0;
+}
+
+static int scan_reduce(int worker, void * arg)
+{
+    scan_ctx * ctx = arg;
+    ctx->total += ctx->bytes[worker];
+    return ctx->bad[worker];
+}
+
+static int scan_stop(int worker, const byte * data, fbuff_off offset,
+    fbuff_off len, void * arg)
+{
+    return 123;
+}
+
+bool test_fbuff_scan(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    scan_ctx ctx;
+
+    check(fbuff_scan(NULL, 1, 7, ' ', scan_chunk, NULL, &ctx) == FBUFF_BAD_ARG);
+    check(fbuff_scan(btest, 0, 7, ' ', scan_chunk, NULL, &ctx) == FBUFF_BAD_ARG);
+    check(fbuff_scan(btest, 1, 0, ' ', scan_chunk, NULL, &ctx) == FBUFF_BAD_ARG);
+    check(fbuff_scan(btest, 1, 7, 256, scan_chunk, NULL, &ctx) == FBUFF_BAD_ARG);
+    check(fbuff_scan(btest, 1, 7, ' ', NULL, NULL, &ctx) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 10) == 0);
+    check(fbuff_read(btest, 3) == 3);
+
+    memset(&ctx, 0, sizeof(ctx));
+    check(fbuff_scan(btest, SCAN_WORKERS, 7, ' ', scan_chunk, scan_reduce,
+        &ctx) == 0);
+    check(all == ctx.total);
+
+    memset(&ctx, 0, sizeof(ctx));
+    check(fbuff_scan(btest, SCAN_WORKERS, 3, FBSCAN_NO_ALIGN, scan_chunk,
+        NULL, &ctx) == 0);
+    check(all == ctx.bytes[0] + ctx.bytes[1] + ctx.bytes[2] + ctx.bytes[3]);
+
+    check(fbuff_scan(btest, 2, 7, ' ', scan_stop, NULL, &ctx) == 123);
+
+    check(ftell(tfile) == 3);
+    check(fbuff_all_read(btest) == 3);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_next_record(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    fbuff_rec rec;
+    byte * ptr;
+    fbuff_off len;
+
+    check(fbuff_rec_init(NULL, btest, FBREC_NEWLINE, 0) == FBUFF_BAD_ARG);
+    check(fbuff_rec_init(&rec, NULL, FBREC_NEWLINE, 0) == FBUFF_BAD_ARG);
+    check(fbuff_rec_init(&rec, btest, 123, 0) == FBUFF_BAD_ARG);
+    check(fbuff_rec_init(&rec, btest, FBREC_FIXED, 0) == FBUFF_BAD_ARG);
+    check(fbuff_rec_init(&rec, btest, FBREC_PREFIX, 3) == FBUFF_BAD_ARG);
+    check(fbuff_next_record(NULL, &ptr, &len) == FBUFF_BAD_ARG);
+    check(fbuff_next_record(&rec, NULL, &len) == FBUFF_BAD_ARG);
+    check(fbuff_next_record(&rec, &ptr, NULL) == FBUFF_BAD_ARG);
+    check(fbuff_rec_free(NULL) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    FILE * tfile = tfopen();
+
+    check(fbuff_init(btest, tfile, 5) == 0);
+    check(fbuff_rec_init(&rec, btest, FBREC_NEWLINE, 0) == 0);
+    check(fbuff_next_record(&rec, &ptr, &len) == 0);
+    check(all-1 == len);
+    check(memcmp(ptr, test_str, len) == 0);
+    check(fbuff_next_record(&rec, &ptr, &len) == FBUFF_EOF);
+    check(fbuff_rec_free(&rec) == 0);
+
+    check(fbuff_reset(btest) == 0);
+    check(fbuff_rec_init(&rec, btest, FBREC_FIXED, 10) == 0);
+    int i;
+    for (i = 0; i < all/10; ++i)
+    {
+        check(fbuff_next_record(&rec, &ptr, &len) == 0);
+        check(10 == len);
+        check(memcmp(ptr, &test_str[i*10], len) == 0);
+    }
+    check(fbuff_next_record(&rec, &ptr, &len) == FBUFF_FERR);
+    check(fbuff_rec_free(&rec) == 0);
+    fbuff_free(btest);
+
+    check(fbuff_init(btest, tfile, 64) == 0);
+    check(fbuff_rec_init(&rec, btest, FBREC_FIXED, 4) == 0);
+    check(fbuff_next_record(&rec, &ptr, &len) == 0);
+    check(4 == len);
+    check(memcmp(ptr, "The ", len) == 0);
+    byte * out;
+    check(fbuff_data(btest, &out) == 0);
+    check(ptr == out);
+    check(fbuff_rec_free(&rec) == 0);
+    fbuff_free(btest);
+    fclose(tfile);
+
+    static const byte framed[] = {
+        3, 0, 'a', 'b', 'c',
+        0, 0,
+        5, 0, 'd', 'e', 'f', 'g', 'h',
+        1, 0, 'i'
+    };
+    FILE * pfile = tmpfile();
+    check(pfile != NULL);
+    check(fwrite(framed, 1, sizeof(framed), pfile) == sizeof(framed));
+    rewind(pfile);
+
+    check(fbuff_init(btest, pfile, 3) == 0);
+    check(fbuff_rec_init(&rec, btest, FBREC_PREFIX, 2) == 0);
+    check(fbuff_next_record(&rec, &ptr, &len) == 0);
+    check(3 == len && memcmp(ptr, "abc", 3) == 0);
+    check(fbuff_next_record(&rec, &ptr, &len) == 0);
+    check(0 == len);
+    check(fbuff_next_record(&rec, &ptr, &len) == 0);
+    check(5 == len && memcmp(ptr, "defgh", 5) == 0);
+    check(fbuff_next_record(&rec, &ptr, &len) == 0);
+    check(1 == len && memcmp(ptr, "i", 1) == 0);
+    check(fbuff_next_record(&rec, &ptr, &len) == FBUFF_EOF);
+    check(fbuff_rec_free(&rec) == 0);
+    fbuff_free(btest);
+    fclose(pfile);
+
+    static const byte huge[] = {
+        0, 0, 0, 0, 0, 0, 0, 0x80, 'j'
+    };
+    pfile = tmpfile();
+    check(pfile != NULL);
+    check(fwrite(huge, 1, sizeof(huge), pfile) == sizeof(huge));
+
+    int bsz;
+    for (bsz = 3; bsz <= 16; bsz += 13)
+    {
+        rewind(pfile);
+        check(fbuff_init(btest, pfile, bsz) == 0);
+        check(fbuff_rec_init(&rec, btest, FBREC_PREFIX, 8) == 0);
+        check(fbuff_next_record(&rec, &ptr, &len) == FBUFF_FERR);
+        check(fbuff_rec_free(&rec) == 0);
+        fbuff_free(btest);
+    }
+
+    fclose(pfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+bool test_fbuff_find(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    fbuff_off ofs;
+    const byte * fox = (const byte *)"fox";
+
+    check(fbuff_find(NULL, fox, 3, &ofs) == FBUFF_BAD_ARG);
+    check(fbuff_find(btest, NULL, 3, &ofs) == FBUFF_BAD_ARG);
+    check(fbuff_find(btest, fox, 0, &ofs) == FBUFF_BAD_ARG);
+    check(fbuff_find(btest, fox, 3, NULL) == FBUFF_BAD_ARG);
+    check(fbuff_find_byte(NULL, 'x', &ofs) == FBUFF_BAD_ARG);
+    check(fbuff_find_byte(btest, 256, &ofs) == FBUFF_BAD_ARG);
+    check(fbuff_find_byte(btest, 'x', NULL) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    byte * out;
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 4) == 0);
+
+    check(fbuff_find(btest, fox, 3, &ofs) == 0);
+    check(16 == ofs);
+    check(fbuff_get_offset(btest) == 16);
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, "fox", 3) == 0);
+
+    const char * dog = "the lazy dog.\n";
+    check(fbuff_find(btest, (const byte *)dog, strlen(dog), &ofs) == 0);
+    check(all - (int)strlen(dog) == ofs);
+
+    check(fbuff_find(btest, fox, 3, &ofs) == FBUFF_EOF);
+    check(fbuff_state(btest) == FBUFF_EOF);
+
+    check(fbuff_reset(btest) == 0);
+    check(fbuff_find_byte(btest, 'z', &ofs) == 0);
+    check(37 == ofs);
+    check(fbuff_find_byte(btest, 'z', &ofs) == 0);
+    check(37 == ofs);
+    check(fbuff_read(btest, 1) == 1);
+    check(fbuff_find_byte(btest, 'z', &ofs) == FBUFF_EOF);
+
+    const char * longer = "quick brown fox jumps over the lazy dog";
+    check(fbuff_reset(btest) == 0);
+    check(fbuff_find(btest, (const byte *)longer, strlen(longer), &ofs) == 0);
+    check(4 == ofs);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+#define READV_RANGES 7
+typedef struct readv_ctx {
+    char data[READV_RANGES][16];
+    fbuff_off len[READV_RANGES];
+    int calls[READV_RANGES];
+} readv_ctx;
+
+static int readv_range(fbuff_off index, const byte * data, fbuff_off len,
+    void * arg)
+{
+    readv_ctx * ctx = arg;
+    memcpy(ctx->data[index], data, (size_t)len);
+    ctx->len[index] = len;
+    ++ctx->calls[index];
+    return 0;
+}
+
+static int readv_stop(fbuff_off index, const byte * data, fbuff_off len,
+    void * arg)
+{
+    return (2 == index) ? 77 : 0;
+}
+
+bool test_fbuff_readv(void)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    readv_ctx ctx;
+    fbuff_io_stats st;
+
+    int all = strlen(test_str);
+    fbuff_range ranges[READV_RANGES] = {
+        {16, 3},
+        {4, 5},
+        {-4, 4},
+        {40, 10},
+        {all, 0},
+        {10, 5},
+        {4, 5}
+    };
+    const char * want[READV_RANGES] = {
+        "fox", "quick", "og.\n", "dog.\n", "", "brown", "quick"
+    };
+
+    check(fbuff_readv(NULL, ranges, 1, 1, readv_range, &ctx) == FBUFF_BAD_ARG);
+    check(fbuff_readv(btest, NULL, 1, 1, readv_range, &ctx) == FBUFF_BAD_ARG);
+    check(fbuff_readv(btest, ranges, -1, 1, readv_range, &ctx)
+        == FBUFF_BAD_ARG);
+    check(fbuff_readv(btest, ranges, 1, 0, readv_range, &ctx)
+        == FBUFF_BAD_ARG);
+    check(fbuff_readv(btest, ranges, 1, 1, NULL, &ctx) == FBUFF_BAD_ARG);
+
+    FILE * tfile = tfopen();
+    check(fbuff_init(btest, tfile, 10) == 0);
+    check(fbuff_read(btest, 3) == 3);
+    check(fbuff_readv(btest, NULL, 0, 1, readv_range, &ctx) == 0);
+
+    int w, i;
+    for (w = 1; w <= SCAN_WORKERS; w += SCAN_WORKERS - 1)
+    {
+        memset(&ctx, 0, sizeof(ctx));
+        check(fbuff_stats(btest, &st) == 0);
+        fbuff_off reads = st.ops[FBUFF_OP_READ_AT].count;
+
+        check(fbuff_readv(btest, ranges, READV_RANGES, w, readv_range,
+            &ctx) == 0);
+        for (i = 0; i < READV_RANGES; ++i)
+        {
+            check(1 == ctx.calls[i]);
+            check(ctx.len[i] == (fbuff_off)strlen(want[i]));
+            check(memcmp(ctx.data[i], want[i], ctx.len[i]) == 0);
+        }
+
+        check(fbuff_stats(btest, &st) == 0);
+#ifndef FBUFF_NO_STATS
+        check(st.ops[FBUFF_OP_READ_AT].count == reads + 1);
+#else
+        (void)reads;
+#endif
+    }
+
+    check(fbuff_readv(btest, ranges, READV_RANGES, 2, readv_stop, NULL)
+        == 77);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ranges[1].offset = all + 1;
+    check(fbuff_readv(btest, ranges, READV_RANGES, 1, readv_range, &ctx)
+        == FBUFF_BAD_OFFSET);
+    ranges[1].offset = 4;
+    ranges[3].len = -1;
+    check(fbuff_readv(btest, ranges, READV_RANGES, 1, readv_range, &ctx)
+        == FBUFF_BAD_ARG);
+    check(0 == ctx.calls[0]);
+
+    check(ftell(tfile) == 3);
+    check(fbuff_all_read(btest) == 3);
+
+    fbuff_free_null(btest);
+    fclose(tfile);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+static bool writer_check(FILE * pfile, fbuff_off len)
+{
+    fbuff btest_;
+    fbuff * btest = &btest_;
+    byte * out;
+
+    rewind(pfile);
+    check(fbuff_init(btest, pfile, 64) == 0);
+    check(fbuff_file_size(btest) == len);
+    check(fbuff_read(btest, FBUFF_FILL) == len);
+    check(fbuff_data(btest, &out) == 0);
+    check(memcmp(out, test_str, len) == 0);
+    fbuff_free(btest);
+    return true;
+}
+
+bool test_fbuff_writer(void)
+{
+    fbuff_writer fw_;
+    fbuff_writer * fw = &fw_;
+    const byte * str = (const byte *)test_str;
+    byte * ptr = NULL;
+
+    check(fbuff_writer_init(NULL, stdout, 8) == FBUFF_BAD_ARG);
+    check(fbuff_writer_init(fw, NULL, 8) == FBUFF_BAD_ARG);
+    check(fbuff_writer_init(fw, stdout, 0) == FBUFF_BAD_ARG);
+    check(fbuff_writer_init_fd(fw, -1, 8) == FBUFF_BAD_ARG);
+    check(fbuff_writer_set_sync(NULL, FBWRITE_SYNC_NEVER, 0) == FBUFF_BAD_ARG);
+    check(fbuff_writer_append(NULL, str, 1) == FBUFF_BAD_ARG);
+    check(fbuff_writer_reserve(NULL, 1, &ptr) == FBUFF_BAD_ARG);
+    check(fbuff_writer_commit(NULL, 0) == FBUFF_BAD_ARG);
+    check(fbuff_writer_flush(NULL) == FBUFF_BAD_ARG);
+    check(fbuff_writer_sync(NULL) == FBUFF_BAD_ARG);
+    check(fbuff_writer_state(NULL) == FBUFF_BAD_ARG);
+    check(fbuff_writer_all_written(NULL) == FBUFF_BAD_ARG);
+    check(fbuff_writer_free(NULL) == FBUFF_BAD_ARG);
+
+    int all = strlen(test_str);
+    int pass;
+    for (pass = 0; pass < 2; ++pass)
+    {
+        FILE * pfile = tmpfile();
+        check(pfile != NULL);
+        if (0 == pass)
+            check(fbuff_writer_init(fw, pfile, 8) == 0);
+        else
+            check(fbuff_writer_init_fd(fw, fileno(pfile), 8) == 0);
+
+        check(fbuff_writer_set_sync(fw, FBWRITE_SYNC_CLOSE+1, 0)
+            == FBUFF_BAD_ARG);
+        check(fbuff_writer_set_sync(fw, FBWRITE_SYNC_BYTES, 0)
+            == FBUFF_BAD_ARG);
+        check(fbuff_writer_set_sync(fw, FBWRITE_SYNC_BYTES | FBWRITE_SYNC_DATA,
+            16) == 0);
+        check(fbuff_writer_append(fw, str, -1) == FBUFF_BAD_ARG);
+        check(fbuff_writer_append(fw, NULL, 1) == FBUFF_BAD_ARG);
+
+        check(fbuff_writer_append(fw, str, 3) == 3);
+        check(fbuff_writer_append(fw, str+3, 0) == 0);
+        check(fbuff_writer_append(fw, str+3, 7) == 7);
+        check(fbuff_writer_append(fw, str+10, 10) == 10);
+        check(fbuff_writer_all_written(fw) == 20);
+        check(fbuff_writer_flush(fw) == 0);
+        check(writer_check(pfile, 20));
+        check(fseek(pfile, 0, SEEK_END) == 0);
+
+        check(fbuff_writer_reserve(fw, 0, &ptr) == FBUFF_BAD_ARG);
+        check(fbuff_writer_reserve(fw, 9, &ptr) == FBUFF_BAD_ARG);
+        check(fbuff_writer_reserve(fw, 6, NULL) == FBUFF_BAD_ARG);
+        check(fbuff_writer_commit(fw, 1) == FBUFF_BAD_ARG);
+        check(fbuff_writer_reserve(fw, 6, &ptr) == 0);
+        memcpy(ptr, str+20, 5);
+        check(fbuff_writer_commit(fw, 7) == FBUFF_BAD_ARG);
+        check(fbuff_writer_commit(fw, 5) == 0);
+        check(fbuff_writer_commit(fw, 1) == FBUFF_BAD_ARG);
+        check(fbuff_writer_reserve(fw, 8, &ptr) == 0);
+        memcpy(ptr, str+25, 8);
+        check(fbuff_writer_commit(fw, 8) == 0);
+        check(fbuff_writer_reserve(fw, 4, &ptr) == 0);
+        check(fbuff_writer_append(fw, str+33, 4) == 4);
+        check(fbuff_writer_commit(fw, 4) == FBUFF_BAD_ARG);
+        check(fbuff_writer_append(fw, str+37, all-37) == all-37);
+        check(fbuff_writer_all_written(fw) == all);
+        check(fbuff_writer_sync(fw) == 0);
+        check(fbuff_writer_state(fw) == 0);
+        check(writer_check(pfile, all));
+
+        check(fbuff_writer_free(fw) == 0);
+        check(NULL == fw->data);
+        fclose(pfile);
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+
+#ifdef TEST_POSIX
+static void * pool_giver(void * arg)
+{
+    void ** args = arg;
+    usleep(20000);
+    if (fbuff_pool_put(args[0], args[1], FBPOOL_MIN_CLASS) != 0)
+        return arg;
+    return NULL;
+}
+
+static void * pool_user(void * arg)
+{
+    byte * buff;
+    if (fbuff_pool_get(arg, 100, &buff) != 0)
+        return arg;
+    fbuff_pool_put(arg, buff, 100);
+    return buff;
+}
+#endif
+
+bool test_fbuff_pool(void)
+{
+    fbuff_pool * pool;
+    fbuff_pool_usage use;
+    byte * a, * b, * c;
+
+    check(fbuff_pool_new(NULL, 0, 0, 0) == FBUFF_BAD_ARG);
+    check(fbuff_pool_new(&pool, -1, 0, 0) == FBUFF_BAD_ARG);
+    check(fbuff_pool_new(&pool, 0, 0, 0x100) == FBUFF_BAD_ARG);
+    check(fbuff_pool_class(0) == FBUFF_BAD_ARG);
+    check(fbuff_pool_class(FBPOOL_MAX_SIZE + 1) == FBUFF_BAD_ARG);
+    check(fbuff_pool_class(1) == FBPOOL_MIN_CLASS);
+    check(fbuff_pool_class(FBPOOL_MIN_CLASS + 1) == 2 * FBPOOL_MIN_CLASS);
+    check(fbuff_pool_class(FBPOOL_MAX_SIZE) == FBPOOL_MAX_SIZE);
+
+    check(fbuff_pool_new(&pool, 0, 0, 0) == 0);
+    check(fbuff_pool_get(NULL, 10, &a) == FBUFF_BAD_ARG);
+    check(fbuff_pool_get(pool, 0, &a) == FBUFF_BAD_ARG);
+    check(fbuff_pool_get(pool, 10, NULL) == FBUFF_BAD_ARG);
+    check(fbuff_pool_put(pool, NULL, 10) == FBUFF_BAD_ARG);
+    check(fbuff_pool_stats(pool, NULL) == FBUFF_BAD_ARG);
+    check(fbuff_pool_free(NULL) == FBUFF_BAD_ARG);
+
+    check(fbuff_pool_get(pool, 5000, &a) == 0);
+    memset(a, 'a', 2 * FBPOOL_MIN_CLASS);
+    check(fbuff_pool_get(pool, 5000, &b) == 0);
+    check(a != b);
+    check(fbuff_pool_put(pool, a, 5000) == 0);
+    check(fbuff_pool_get(pool, 2 * FBPOOL_MIN_CLASS, &c) == 0);
+    check(c == a);
+    check(fbuff_pool_stats(pool, &use) == 0);
+    check(2 == use.allocs);
+    check(4 * FBPOOL_MIN_CLASS == use.held);
+    check(0 == use.waits);
+    check(fbuff_pool_put(pool, b, 5000) == 0);
+    check(fbuff_pool_put(pool, c, 5000) == 0);
+    check(fbuff_pool_free(pool) == 0);
+
+    check(fbuff_pool_new(&pool, 4 * FBPOOL_MIN_CLASS, 0, 0) == 0);
+    check(fbuff_pool_get(pool, 2 * FBPOOL_MIN_CLASS, &a) == 0);
+    check(fbuff_pool_get(pool, 2 * FBPOOL_MIN_CLASS, &b) == 0);
+    check(fbuff_pool_get(pool, 1, &c) == FBUFF_BAD_ALLOC);
+    check(fbuff_pool_put(pool, a, 2 * FBPOOL_MIN_CLASS) == 0);
+    check(fbuff_pool_get(pool, 1, &c) == 0);
+    check(fbuff_pool_stats(pool, &use) == 0);
+    check(3 * FBPOOL_MIN_CLASS == use.held);
+    check(fbuff_pool_put(pool, b, 2 * FBPOOL_MIN_CLASS) == 0);
+    check(fbuff_pool_put(pool, c, 1) == 0);
+    check(fbuff_pool_free(pool) == 0);
+
+    check(fbuff_pool_new(&pool, 0, 0, FBPOOL_HUGE) == 0);
+    check(fbuff_pool_get(pool, FBPOOL_HUGE_SIZE, &a) == 0);
+    memset(a, 'h', FBPOOL_HUGE_SIZE);
+    check(fbuff_pool_put(pool, a, FBPOOL_HUGE_SIZE) == 0);
+    check(fbuff_pool_get(pool, FBPOOL_HUGE_SIZE - 1, &b) == 0);
+    check(a == b);
+    check(fbuff_pool_put(pool, b, FBPOOL_HUGE_SIZE) == 0);
+    check(fbuff_pool_free(pool) == 0);
+
+#ifdef TEST_POSIX
+    pthread_t thread;
+    void * ret = NULL;
+    void * args[2];
+
+    check(fbuff_pool_new(&pool, FBPOOL_MIN_CLASS, 5000, 0) == 0);
+    check(fbuff_pool_get(pool, 10, &a) == 0);
+    args[0] = pool;
+    args[1] = a;
+    check(pthread_create(&thread, NULL, pool_giver, args) == 0);
+    check(fbuff_pool_get(pool, 10, &b) == 0);
+    check(pthread_join(thread, &ret) == 0);
+    check(NULL == ret);
+    check(a == b);
+    check(fbuff_pool_stats(pool, &use) == 0);
+    check(1 == use.waits);
+    check(1 == use.allocs);
+    check(fbuff_pool_put(pool, b, 10) == 0);
+    check(fbuff_pool_free(pool) == 0);
+
+    check(fbuff_pool_new(&pool, 0, 0, 0) == 0);
+    check(pthread_create(&thread, NULL, pool_user, pool) == 0);
+    check(pthread_join(thread, &ret) == 0);
+    check(ret != pool);
+    check(fbuff_pool_get(pool, 10, &a) == 0);
+    check((void *)a == ret);
+    check(fbuff_pool_put(pool, a, 10) == 0);
+    check(fbuff_pool_free(pool) == 0);
+#endif
+    return true;
+}
+//------------------------------------------------------------------------------
+
+static bool fileset_check(const char * const * paths, fbuff_off n,
+    const fbuff_off * lens, int depth)
+{
+    fbuff_fileset * fs;
+    fbuff_chunk ch;
+    fbuff_off i, bsz = 16;
+
+    check(fbuff_fileset_new(&fs, paths, n, bsz, depth) == 0);
+    for (i = 0; i < n; ++i)
+    {
+        fbuff_off off = 0;
+        do
+        {
+            check(fbuff_fileset_next(fs, &ch) == 0);
+            check(ch.index == i);
+            check(ch.offset == off);
+            check(ch.len <= bsz);
+            if (lens[i] < 0)
+            {
+                check(FBUFF_FERR == ch.err);
+                check(0 == ch.len);
+            }
+            else
+            {
+                check(0 == ch.err);
+                check(memcmp(ch.data, &test_str[off], ch.len) == 0);
+            }
+            off += ch.len;
+        } while (!ch.last);
+
+        if (lens[i] >= 0)
+            check(lens[i] == off);
+    }
+    check(fbuff_fileset_next(fs, &ch) == FBUFF_EOF);
+    check(fbuff_fileset_next(fs, &ch) == FBUFF_EOF);
+    check(fbuff_fileset_free(fs) == 0);
+    return true;
+}
+
+bool test_fbuff_fileset(void)
+{
+    fbuff_fileset * fs;
+    fbuff_chunk ch;
+    const char * paths[4] = {NULL};
+    fbuff_off lens[4];
+    fbuff_off all = strlen(test_str);
+
+    check(fbuff_fileset_new(NULL, paths, 1, 16, 2) == FBUFF_BAD_ARG);
+    check(fbuff_fileset_new(&fs, NULL, 1, 16, 2) == FBUFF_BAD_ARG);
+    check(fbuff_fileset_new(&fs, paths, -1, 16, 2) == FBUFF_BAD_ARG);
+    check(fbuff_fileset_new(&fs, paths, 1, 0, 2) == FBUFF_BAD_ARG);
+    check(fbuff_fileset_new(&fs, paths, 1, 16, 0) == FBUFF_BAD_ARG);
+    check(fbuff_fileset_next(NULL, &ch) == FBUFF_BAD_ARG);
+    check(fbuff_fileset_free(NULL) == FBUFF_BAD_ARG);
+
+    check(fbuff_fileset_new(&fs, NULL, 0, 16, 2) == 0);
+    check(fbuff_fileset_next(fs, NULL) == FBUFF_BAD_ARG);
+    check(fbuff_fileset_next(fs, &ch) == FBUFF_EOF);
+    check(fbuff_fileset_free(fs) == 0);
+
+    paths[0] = test_file;
+    paths[1] = "fbuff_no_such_file";
+    paths[2] = test_file;
+    lens[0] = lens[2] = all;
+    lens[1] = -1;
+    check(fileset_check(paths, 3, lens, 2));
+    check(fileset_check(paths, 3, lens, 1));
+
+    check(fbuff_fileset_new(&fs, paths, 3, 16, 4) == 0);
+    check(fbuff_fileset_next(fs, &ch) == 0);
+    check(memcmp(ch.data, test_str, 16) == 0);
+    check(fbuff_fileset_free(fs) == 0);
+
+#ifdef TEST_POSIX
+    char empty[] = "/tmp/fbuff_fileset_XXXXXX";
+    char exact[] = "/tmp/fbuff_fileset_XXXXXX";
+    int efd = mkstemp(empty);
+    int xfd = mkstemp(exact);
+    check(efd >= 0 && xfd >= 0);
+    check(write(xfd, test_str, 32) == 32);
+    close(efd);
+    close(xfd);
+
+    paths[0] = empty;
+    paths[1] = exact;
+    paths[2] = "/tmp";
+    paths[3] = test_file;
+    lens[0] = 0;
+    lens[1] = 32;
+    lens[2] = -1;
+    lens[3] = all;
+    bool ok = fileset_check(paths, 4, lens, 3);
+    unlink(empty);
+    unlink(exact);
+    check(ok);
+#endif
+    return true;
+}
+//------------------------------------------------------------------------------
+
 void run_tests(void)
 {
     int i, end = sizeof(tests)/sizeof(*tests);